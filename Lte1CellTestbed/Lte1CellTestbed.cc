@@ -14,6 +14,12 @@ Run Commands:
 #include <ns3/config-store.h>
 
 #include "progress-bar.h"
+#include "../common/cached-propagation-loss-model.h"
+#include "../common/event-profiler.h"
+#include "../common/fast-exit.h"
+#include "../common/phase-timer.h"
+#include "../common/scenario-builder.h"
+#include "../common/scheduler-type.h"
 
 using namespace ns3;
 
@@ -21,30 +27,48 @@ NS_LOG_COMPONENT_DEFINE( "Lte1CellTestbed" );
 
 int main( int argc, char *argv[] ) {
 
+    uint32_t nMobileUes = 4;
+    uint32_t nStaticUes = 4;
+
+    double simDuration    = 75.00;
+
     // Load experiment configuration
+    bool fastExit = false;
+    bool profileEvents = false;
+    std::string scheduler = "";
+    bool cachePathloss = false;
     CommandLine cmd;
+    cmd.AddValue( "nMobileUes", "Users moving between the center and the edge of the cell", nMobileUes );
+    cmd.AddValue( "nStaticUes", "Users placed uniformly in the cell", nStaticUes );
+    cmd.AddValue( "simTime", "Simulated seconds", simDuration );
+    cmd.AddValue( "fastExit", "Flush the traces and exit without tearing down the simulation", fastExit );
+    cmd.AddValue( "profileEvents", "Count and time the events by target, ranked in EventProfile.txt", profileEvents );
+    cmd.AddValue( "scheduler", "Event queue: map, heap, list or calendar [Default: ns-3 SchedulerType]", scheduler );
+    cmd.AddValue( "cachePathloss", "Cache the pathloss between static nodes", cachePathloss );
     cmd.Parse( argc, argv );
     ConfigStore inputConfig;
     inputConfig.ConfigureDefaults();
     cmd.Parse( argc, argv );    
+    FastExit::Enable( fastExit );
+    SelectScheduler( scheduler );
+    EventProfiler::Enable( profileEvents );
 
     // Position for Cell Tower -- aa points in 'm'
     double enbX = 0.00, enbY = 0.00, enbZ = 30.00;
     double cellRadius   = 1000.00;
 
-    uint32_t nMobileUes = 4;
-    uint32_t nStaticUes = 4;
-
-    double simDuration    = 75.00;
     Time::SetResolution( Time::NS );
 
     // Create Nodes
+    PhaseTimer::Get().Begin( "nodes" );
     NodeContainer nodesEnb; nodesEnb.Create( 1 );
     NodeContainer nodesUesMobile;   nodesUesMobile.Create( nMobileUes );
     NodeContainer nodesUesStatic;   nodesUesStatic.Create( nStaticUes );
     NodeContainer nodesUes; nodesUes.Add( nodesUesMobile ); nodesUes.Add( nodesUesStatic );
+    PhaseTimer::Get().End();
 
     // Setup mobility models for eNodeBs and UEs
+    PhaseTimer::Get().Begin( "mobility" );
     // Setup mobility for eNodeB -- ConstantPositionMobilityModel
     Ptr<ListPositionAllocator> posAllocEnb = CreateObject<ListPositionAllocator>();
     posAllocEnb->Add( Vector(enbX,enbY,enbZ) );
@@ -76,12 +100,18 @@ int main( int argc, char *argv[] ) {
     mobilityHelperUeStatic.SetMobilityModel( "ns3::ConstantPositionMobilityModel" );
     mobilityHelperUeStatic.SetPositionAllocator( posAllocUeStatic );
     mobilityHelperUeStatic.Install( nodesUesStatic );
+    PhaseTimer::Get().End();
 
     // Setup LTE network
-    Ptr<LteHelper> lteHelper    = CreateObject<LteHelper>();
-    NetDeviceContainer devsEnb; devsEnb = lteHelper->InstallEnbDevice( nodesEnb );
-    NetDeviceContainer devsUes; devsUes = lteHelper->InstallUeDevice( nodesUes );
-    lteHelper->Attach( devsUes, devsEnb.Get(0) );
+    LteScenarioBuilder scenario( LteScenarioBuilder::NO_EPC );
+    Ptr<LteHelper> lteHelper    = scenario.GetLteHelper();
+    if( cachePathloss ) {
+        // Keep the PathlossModel of the config file, only put it behind the cache
+        CacheDefaultPathlossModel( lteHelper );
+    }
+    NetDeviceContainer devsEnb; devsEnb = scenario.InstallEnbDevices( nodesEnb );
+    NetDeviceContainer devsUes; devsUes = scenario.InstallUeDevices( nodesUes );
+    scenario.Attach( devsUes, devsEnb.Get(0) );
 
     // Activate saturation traffic
     enum EpsBearer::Qci q = EpsBearer::GBR_CONV_VOICE;
@@ -90,6 +120,7 @@ int main( int argc, char *argv[] ) {
 
     // Enable Logging
     lteHelper->EnableTraces();
+    FastExit::AddLteStats( lteHelper );
 
     // Setup simulation durtation
     Simulator::Stop( Seconds(simDuration) );
@@ -98,9 +129,24 @@ int main( int argc, char *argv[] ) {
     sim::ProgressBar progressBar( simDuration );
     progressBar.Enable();
 
+
+    PhaseTimer::Get().Begin( "run" );
     Simulator::Run();
+    PhaseTimer::Get().End();
+    EventProfiler::Report( "EventProfile.txt" );    // only with --profileEvents
+    CachedPropagationLossModel::Report( std::cout );    // only with --cachePathloss
+    PhaseTimer::Get().SetValue( "events", Simulator::GetEventCount() );
+    PhaseTimer::Get().SetValue( "sim_s", Simulator::Now().GetSeconds() );
+
+    PhaseTimer::Get().Begin( "destroy" );
+    FastExit::Destroy();    // only flushes with --fastExit
+    PhaseTimer::Get().End();
+
+    // Wall time and peak memory of each phase
+    PhaseTimer::Get().Print( std::cout );
+    PhaseTimer::Get().WriteJson( "PhaseTimes.json" );
 
-    Simulator::Destroy();
+    FastExit::Exit( 0 );    // no teardown with --fastExit
 
     return 0;
 }
\ No newline at end of file
@@ -18,23 +18,61 @@
 
 #include "progress-bar.h"
 
+#include <algorithm>
 #include <cmath>
+#include <cstdio>
+#include <iomanip>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <unistd.h>
 #include "ns3/core-module.h"
 
 namespace sim {
 
 using namespace ns3;
 
+static double
+WallClockSeconds ()
+{
+  struct timeval tv;
+  gettimeofday (&tv, 0);
+  return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+// The buffers of the standard streams at startup, before any rdbuf() swap
+static std::streambuf *const s_stdoutBuf = std::cout.rdbuf ();
+static std::streambuf *const s_stderrBuf = std::cerr.rdbuf ();
+static std::streambuf *const s_stdlogBuf = std::clog.rdbuf ();
+
+static long
+PeakRssKb ()
+{
+  struct rusage ru;
+  getrusage (RUSAGE_SELF, &ru);
+#ifdef __APPLE__
+  return ru.ru_maxrss / 1024;   // bytes on OS X
+#else
+  return ru.ru_maxrss;          // kilobytes on Linux
+#endif
+}
+
 ProgressBar::ProgressBar (double time) :
     m_time (time),
     m_size (50),
     m_resolution (100),
-    m_out (&std::clog)
+    m_out (&std::clog),
+    m_json (false),
+    m_jsonForced (false),
+    m_wallStart (0),
+    m_lastWall (0),
+    m_lastSim (0),
+    m_lastEvents (0)
 {
 }
 
 ProgressBar::~ProgressBar ()
 {
+  m_event.Cancel ();
 }
 
 void
@@ -61,20 +99,73 @@ ProgressBar::SetOstream (std::ostream *p)
   m_out = p;
 }
 
+void
+ProgressBar::SetJson (bool json)
+{
+  m_json = json;
+  m_jsonForced = true;
+}
+
+bool
+ProgressBar::IsTerminal () const
+{
+  // Look at the buffer m_out writes through, not at which stream it is: a
+  // standard stream redirected with rdbuf() goes to a file
+  std::streambuf *buf = m_out->rdbuf ();
+  if (buf == s_stdoutBuf)
+    return isatty (STDOUT_FILENO);
+  if (buf == s_stderrBuf || buf == s_stdlogBuf)
+    return isatty (STDERR_FILENO);
+  return false;   // files and string streams
+}
+
 void
 ProgressBar::Enable ()
 {
-  for (int i = 0; i <= m_resolution; i++)
-    {
-      double t = (double) i / m_resolution * m_time;
-      Simulator::Schedule (Seconds (t), &ProgressBar::Update, this);
-    }
+  if (!m_jsonForced)
+    m_json = !IsTerminal ();
+  m_wallStart = WallClockSeconds ();
+  m_lastWall = m_wallStart;
+  m_lastSim = Simulator::Now ().GetSeconds ();
+  m_lastEvents = Simulator::GetEventCount ();
+  m_event = Simulator::Schedule (Seconds (0), &ProgressBar::Update, this);
 }
 
 void
 ProgressBar::Update ()
 {
   double now = Simulator::Now ().GetSeconds ();
+  double wall = WallClockSeconds ();
+  uint64_t events = Simulator::GetEventCount ();
+
+  double dWall = wall - m_lastWall;
+  double eventRate = dWall > 0 ? (events - m_lastEvents) / dWall : 0;
+  double simRate = dWall > 0 ? (now - m_lastSim) / dWall : 0;
+  // ETA from the average speed since Enable(), the last interval alone is too noisy
+  double elapsed = wall - m_wallStart;
+  double eta = (now > 0 && elapsed > 0) ? (m_time - now) * elapsed / now : -1;
+  long peakRssKb = PeakRssKb ();
+
+  if (m_json)
+    PrintJson (now, events, elapsed, eventRate, simRate, eta, peakRssKb);
+  else
+    PrintBar (now, eventRate, simRate, eta, peakRssKb);
+
+  m_lastWall = wall;
+  m_lastSim = now;
+  m_lastEvents = events;
+
+  // Schedule only the next tick, clamped to the end of the simulation
+  if (now < m_time)
+    {
+      double next = std::min (m_time, now + m_time / m_resolution);
+      m_event = Simulator::Schedule (Seconds (next - now), &ProgressBar::Update, this);
+    }
+}
+
+void
+ProgressBar::PrintBar (double now, double eventRate, double simRate, double eta, long peakRssKb)
+{
   int nMarks = (int) (now / m_time * m_size);
   int percent = (int) (now / m_time * 100);
 
@@ -89,9 +180,38 @@ ProgressBar::Update ()
   *m_out << "] ";
 
   *m_out << (int) now << "s " << percent << "% ";
+
+  std::ios_base::fmtflags flags = m_out->flags ();
+  std::streamsize precision = m_out->precision ();
+  *m_out << std::fixed << std::setprecision (0) << eventRate << " ev/s "
+         << std::setprecision (3) << simRate << " sim-s/s ";
+  if (eta >= 0)
+    {
+      int etaSec = (int) eta;
+      *m_out << "ETA " << etaSec / 3600 << ":" << std::setw (2) << std::setfill ('0') << (etaSec / 60) % 60
+             << ":" << std::setw (2) << etaSec % 60 << std::setfill (' ') << " ";
+    }
+  *m_out << peakRssKb / 1024 << " MB  ";
+  m_out->flags (flags);
+  m_out->precision (precision);
+
   if (nMarks == m_size)
     *m_out << '\n';
   *m_out << std::flush;
 }
 
+void
+ProgressBar::PrintJson (double now, uint64_t events, double wall, double eventRate, double simRate, double eta, long peakRssKb)
+{
+  *m_out << "{\"sim_time\":" << now
+         << ",\"progress\":" << now / m_time
+         << ",\"wall_time\":" << wall
+         << ",\"events\":" << events
+         << ",\"events_per_sec\":" << eventRate
+         << ",\"sim_per_wall\":" << simRate
+         << ",\"eta_sec\":" << eta
+         << ",\"peak_rss_kb\":" << peakRssKb
+         << "}" << std::endl;
+}
+
 } /* namespace sim */
@@ -21,11 +21,22 @@
 #define PROGRESS_BAR_H_
 
 #include <iostream>
+#include <stdint.h>
+
+#include "ns3/event-id.h"
 
 namespace sim {
 
 /*
- * A basic progress bar for tracking simulation time.
+ * A progress bar for tracking simulation time.
+ *
+ * Only the next update is ever scheduled. Besides the simulated time, each
+ * update reports the event rate, the simulated seconds per wall-clock second,
+ * an estimate of the remaining wall-clock time and the peak resident memory.
+ * The bar is written to std::clog (stderr) unless SetOstream() picks another
+ * stream. When that stream does not end up on a terminal, one JSON object
+ * per update is written instead of the bar, so logs of batch runs can be
+ * parsed: redirecting stderr switches to JSON, redirecting stdout doesn't.
  */
 class ProgressBar
 {
@@ -33,7 +44,15 @@ private:
   double m_time;        // The time, in seconds, corresponding to 100% progress
   int m_size;           // How wide the progress bar should be (fixed width terminals)
   int m_resolution;     // How often to update the progress bar (will be updated every time/resolution seconds)
-  std::ostream *m_out;  // Where to print the progress bar
+  std::ostream *m_out;  // Where to print the progress bar, std::clog by default
+  bool m_json;          // Print JSON lines instead of the bar
+  bool m_jsonForced;    // m_json was set explicitly, don't guess it from m_out
+
+  double m_wallStart;       // Wall-clock time when Enable() was called
+  double m_lastWall;        // Wall-clock time of the previous update
+  double m_lastSim;         // Simulated time of the previous update
+  uint64_t m_lastEvents;    // Simulator event count at the previous update
+  ns3::EventId m_event;     // The pending update
 
 public:
   explicit ProgressBar (double time);
@@ -43,10 +62,14 @@ public:
   void SetResolution (int resolution);
   void SetCheckpoint (double time);
   void SetOstream (std::ostream *p);
+  void SetJson (bool json);
   void Enable ();
 
 private:
   void Update ();
+  void PrintBar (double now, double eventRate, double simRate, double eta, long peakRssKb);
+  void PrintJson (double now, uint64_t events, double wall, double eventRate, double simRate, double eta, long peakRssKb);
+  bool IsTerminal () const;
 };
 
 } /* namespace sim */
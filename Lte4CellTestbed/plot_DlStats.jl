@@ -3,8 +3,15 @@
 using PyPlot
 
 
-# Load Data
-data, header = readdlm( "./DlRsrpSinrStats.txt", '\t', header=true );
+include( "../common/read_columnar_trace.jl" );
+
+# Load Data -- the columnar trace (--columnarTraces=1) if there is one
+if isfile( "./DlRsrpSinrStats.ctr" )
+    data = columnar_trace_matrix( read_columnar_trace("./DlRsrpSinrStats.ctr"),
+                                  ["time","cellId","IMSI","RNTI","rsrp","sinr"] );
+else
+    data, header = readdlm( "./DlRsrpSinrStats.txt", '\t', header=true );
+end
 cellId  = 3
 
 noOfUsers   = unique( data[:,3] );
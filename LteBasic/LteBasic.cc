@@ -8,35 +8,55 @@
 #include <ns3/lte-module.h>
 #include <ns3/config-store.h>
 
+#include "../common/event-profiler.h"
+#include "../common/fast-exit.h"
+#include "../common/phase-timer.h"
+#include "../common/scenario-builder.h"
+#include "../common/scheduler-type.h"
+
 using namespace ns3;
 
 int main( int argc, char *argv[] ) {
 
+    bool fastExit = false;
+    bool profileEvents = false;
+    std::string scheduler = "";
     CommandLine cmd;
+    cmd.AddValue( "fastExit", "Flush the traces and exit without tearing down the simulation", fastExit );
+    cmd.AddValue( "profileEvents", "Count and time the events by target, ranked in EventProfile.txt", profileEvents );
+    cmd.AddValue( "scheduler", "Event queue: map, heap, list or calendar [Default: ns-3 SchedulerType]", scheduler );
     cmd.Parse( argc, argv );
     ConfigStore inputConfig;
     inputConfig.ConfigureDefaults();
     cmd.Parse( argc, argv );
+    FastExit::Enable( fastExit );
+    SelectScheduler( scheduler );
+    EventProfiler::Enable( profileEvents );
 
 
-    // Create a LteHelper
-    Ptr<LteHelper> lteHelper    = CreateObject<LteHelper>();
+    // Create a LteHelper, radio only
+    LteScenarioBuilder scenario( LteScenarioBuilder::NO_EPC );
+    Ptr<LteHelper> lteHelper    = scenario.GetLteHelper();
 
     // Create eNodeBs and UEs
+    PhaseTimer::Get().Begin( "nodes" );
     NodeContainer enbNodes;     enbNodes.Create( 1 );
     NodeContainer ueNodes;      ueNodes.Create( 2 );
+    PhaseTimer::Get().End();
 
     // Setup mobility
+    PhaseTimer::Get().Begin( "mobility" );
     MobilityHelper  mobility;
     mobility.SetMobilityModel( "ns3::ConstantPositionMobilityModel" );  mobility.Install( enbNodes );
     mobility.SetMobilityModel( "ns3::ConstantPositionMobilityModel" );  mobility.Install( ueNodes );
+    PhaseTimer::Get().End();
 
     // Install LTE stack
-    NetDeviceContainer  enbDevs;    enbDevs = lteHelper->InstallEnbDevice( enbNodes );
-    NetDeviceContainer  ueDevs;     ueDevs  = lteHelper->InstallUeDevice( ueNodes );
+    NetDeviceContainer  enbDevs;    enbDevs = scenario.InstallEnbDevices( enbNodes );
+    NetDeviceContainer  ueDevs;     ueDevs  = scenario.InstallUeDevices( ueNodes );
 
     // Attach UEs to eNodeBs
-    lteHelper->Attach( ueDevs, enbDevs.Get(0) );
+    scenario.Attach( ueDevs, enbDevs.Get(0) );
 
     // Activate saturation traffic
     enum EpsBearer::Qci q   = EpsBearer::GBR_CONV_VOICE;
@@ -51,12 +71,24 @@ int main( int argc, char *argv[] ) {
     lteHelper->EnableMacTraces();
     lteHelper->EnableRlcTraces();
     lteHelper->EnablePdcpTraces();
+    FastExit::AddLteStats( lteHelper );
 
     // Run Simulation
+    PhaseTimer::Get().Begin( "run" );
     Simulator::Run();
+    PhaseTimer::Get().End();
+    EventProfiler::Report( "EventProfile.txt" );    // only with --profileEvents
 
     // End Simulation
-    Simulator::Destroy();
+    PhaseTimer::Get().Begin( "destroy" );
+    FastExit::Destroy();    // only flushes with --fastExit
+    PhaseTimer::Get().End();
+
+    // Wall time and peak memory of each phase
+    PhaseTimer::Get().Print( std::cout );
+    PhaseTimer::Get().WriteJson( "PhaseTimes.json" );
+
+    FastExit::Exit( 0 );    // no teardown with --fastExit
 
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,508 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Scaling benchmark of the LTE scenarios over users per cell, cells and
+// event schedulers.
+//
+// Every point of the grid is run as an isolated process in its own
+// directory, one at a time by default so that the runs don't compete for
+// cores and memory bandwidth:
+//  - "testbed": Lte4CellTestbed with a generated hex grid topology.cfg
+//    (omni sites, or sites of 3 sectors when the cell count is a multiple
+//    of 3, e.g. 57 = 19 x 3), all users static
+//  - "watson": LteWatson with --nUes, single cell only
+//  - "1cell": Lte1CellTestbed, half of the users mobile, single cell only
+// --schedulers runs each of them on the given event queues (--scheduler of
+// the scenarios), "default" keeping the SchedulerType of ns-3.
+// Each run reports its event count and simulated time in PhaseTimes.json;
+// wall time and peak RSS are measured here from wait4 (). One CSV row per
+// run, in grid order, with fixed columns and precision so that the files of
+// two commits can be diffed or joined on (scenario, scheduler, cells,
+// ues_per_cell, repeat):
+//
+//   label,scenario,scheduler,cells,ues_per_cell,ues,sim_s,repeat,status,wall_s,run_wall_s,events,events_per_s,sim_wall_ratio,peak_rss_kb
+//
+// wall_s is the whole process, setup and teardown included; events_per_s
+// and sim_wall_ratio are over the Simulator::Run () phase (run_wall_s).
+//
+// ./waf --run "scratch/LteBenchmark/LteBenchmark --uesPerCell=10,50 --cells=1,4 --label=$(git rev-parse --short HEAD)"
+// ./waf --run "scratch/LteBenchmark/LteBenchmark --scenarios=1cell,watson,testbed --schedulers=map,heap,list,calendar --uesPerCell=50 --cells=1,4"
+
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "ns3/core-module.h"
+
+#include "../common/isolated-run.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("LteBenchmark");
+
+namespace {
+
+// One point of the benchmark grid and what was measured
+struct BenchmarkRun
+{
+  uint32_t id;
+  std::string scenario;
+  std::string scheduler;
+  uint32_t cells;
+  uint32_t uesPerCell;
+  uint32_t repeat;
+  std::string dir;
+  pid_t pid;
+  int status;
+  double startTime;
+  double wallTime;
+  long peakRssKb;
+  double runWallTime;   // Simulator::Run (), from PhaseTimes.json
+  double events;
+  double simTime;       // simulated seconds reached, from PhaseTimes.json
+};
+
+std::vector<std::string>
+SplitString (const std::string &str, char delimiter)
+{
+  std::vector<std::string> tokens;
+  std::stringstream ss (str);
+  std::string token;
+  while (std::getline (ss, token, delimiter))
+    {
+      if (!token.empty ())
+        {
+          tokens.push_back (token);
+        }
+    }
+  return tokens;
+}
+
+std::vector<uint32_t>
+SplitNumbers (const std::string &str)
+{
+  std::vector<uint32_t> numbers;
+  std::vector<std::string> tokens = SplitString (str, ',');
+  for (uint32_t i = 0; i < tokens.size (); i++)
+    {
+      numbers.push_back (std::strtoul (tokens[i].c_str (), 0, 10));
+    }
+  return numbers;
+}
+
+double
+WallClockSeconds ()
+{
+  struct timeval tv;
+  gettimeofday (&tv, 0);
+  return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+std::string
+DefaultProgramPath (const char *argv0, const std::string &name)
+{
+  // build/scratch/LteBenchmark/LteBenchmark -> build/scratch/<name>/<name>
+  std::string self (argv0);
+  std::string::size_type slash = self.rfind ('/');
+  std::string dir = (slash == std::string::npos) ? "." : self.substr (0, slash);
+  return dir + "/../" + name + "/" + name;
+}
+
+std::string
+AbsolutePath (const std::string &path)
+{
+  if (path.empty () || path[0] == '/')
+    {
+      return path;
+    }
+  char cwd[4096];
+  if (getcwd (cwd, sizeof (cwd)) == 0)
+    {
+      NS_FATAL_ERROR ("getcwd failed: " << std::strerror (errno));
+    }
+  return std::string (cwd) + "/" + path;
+}
+
+void
+MakeDirectory (const std::string &path)
+{
+  if (mkdir (path.c_str (), 0755) != 0 && errno != EEXIST)
+    {
+      NS_FATAL_ERROR ("Can't create directory " << path << ": " << std::strerror (errno));
+    }
+}
+
+// Hex grid of 'cells' cells with 'uesPerCell' static users each, at 500 m
+// between sites as LteTestbed/topology-57cell.cfg
+void
+WriteTopology (const std::string &filename, uint32_t cells, uint32_t uesPerCell)
+{
+  std::ofstream file (filename.c_str ());
+  if (!file.is_open ())
+    {
+      NS_FATAL_ERROR ("Can't create " << filename);
+    }
+  uint32_t sectors = (cells % 3 == 0) ? 3 : 1;
+  file << "# LteBenchmark: " << cells << " cells, " << uesPerCell << " users per cell\n"
+       << "sites\t" << cells / sectors << "\n"
+       << "sectors\t" << sectors << "\n"
+       << "interSiteDistance\t500\n"
+       << "cellRadius\t" << (sectors == 3 ? 500.0 / 3 : 500.0 / std::sqrt (3.0)) << "\n"
+       << "siteHeight\t30\n"
+       << "staticUes\t" << uesPerCell << "\n"
+       << "mobileUes\t0\n"
+       << "ueHeight\t1.5\n";
+}
+
+std::string
+ScenarioProgram (const std::string &scenario, const std::string &testbed,
+                 const std::string &watson, const std::string &oneCell)
+{
+  if (scenario == "testbed")
+    {
+      return testbed;
+    }
+  return scenario == "watson" ? watson : oneCell;
+}
+
+// Number following "key": in text, from position 'from'; -1 if missing
+double
+FindJsonNumber (const std::string &text, const std::string &key, std::string::size_type from = 0)
+{
+  std::string::size_type pos = text.find ("\"" + key + "\":", from);
+  if (pos == std::string::npos)
+    {
+      return -1;
+    }
+  return std::strtod (text.c_str () + pos + key.size () + 3, 0);
+}
+
+void
+ReadPhaseTimes (BenchmarkRun &run)
+{
+  std::ifstream file ((run.dir + "/PhaseTimes.json").c_str ());
+  if (!file.is_open ())
+    {
+      return;
+    }
+  std::stringstream ss;
+  ss << file.rdbuf ();
+  std::string text = ss.str ();
+  std::string::size_type runPhase = text.find ("\"name\": \"run\"");
+  if (runPhase != std::string::npos)
+    {
+      run.runWallTime = FindJsonNumber (text, "wall_s", runPhase);
+    }
+  run.events = FindJsonNumber (text, "events");
+  run.simTime = FindJsonNumber (text, "sim_s");
+}
+
+std::string
+RunStatus (const BenchmarkRun &run)
+{
+  if (WIFSIGNALED (run.status))
+    {
+      return WTERMSIG (run.status) == SIGALRM ? "timeout" : "killed";
+    }
+  return WIFEXITED (run.status) && WEXITSTATUS (run.status) == 0 ? "ok" : "failed";
+}
+
+const char *CSV_HEADER =
+  "label,scenario,scheduler,cells,ues_per_cell,ues,sim_s,repeat,status,wall_s,run_wall_s,events,events_per_s,sim_wall_ratio,peak_rss_kb";
+
+void
+WriteCsvRow (std::ostream &os, const std::string &label, const BenchmarkRun &run)
+{
+  // sim_s is the simulated time the run reached, not --simTime; it is
+  // empty when the run wrote no PhaseTimes.json (timeout, crash)
+  bool ok = RunStatus (run) == "ok" && run.runWallTime > 0 && run.events >= 0 && run.simTime >= 0;
+  os << label << ',' << run.scenario << ',' << run.scheduler << ',' << run.cells << ',' << run.uesPerCell << ','
+     << run.cells * run.uesPerCell << ',' << std::fixed << std::setprecision (3);
+  if (run.simTime >= 0)
+    {
+      os << run.simTime;
+    }
+  os << ',' << run.repeat << ',' << RunStatus (run) << ',' << run.wallTime << ',';
+  if (ok)
+    {
+      os << run.runWallTime << ',' << std::setprecision (0) << run.events << ','
+         << run.events / run.runWallTime << ',' << std::setprecision (6) << run.simTime / run.runWallTime;
+    }
+  else
+    {
+      os << ",,,";
+    }
+  os << ',' << run.peakRssKb << '\n';
+}
+
+} // anonymous namespace
+
+int
+main (int argc, char *argv[])
+{
+  std::string uesPerCell = "10,50,200,1000";
+  std::string cells = "1,4,19,57";
+  std::string scenarios = "testbed,watson";
+  std::string schedulers = "default";
+  double simTime = 2;
+  uint32_t repeat = 1;
+  uint32_t maxUes = 0;
+  uint32_t timeout = 0;
+  uint32_t jobs = 1;
+  bool fastExit = false;
+  std::string tracePath = "";
+  std::string testbedProgram = DefaultProgramPath (argv[0], "Lte4CellTestbed");
+  std::string watsonProgram = DefaultProgramPath (argv[0], "LteWatson");
+  std::string oneCellProgram = DefaultProgramPath (argv[0], "Lte1CellTestbed");
+  std::string extraArgs = "";
+  std::string outDir = "benchmark";
+  std::string csv = "";
+  std::string label = "";
+  bool append = false;
+
+  CommandLine cmd;
+  cmd.AddValue ("uesPerCell", "Comma separated users per cell", uesPerCell);
+  cmd.AddValue ("cells", "Comma separated cell counts, multiples of 3 are 3-sector sites", cells);
+  cmd.AddValue ("scenarios", "Comma separated scenarios: testbed (Lte4CellTestbed), watson (LteWatson, 1 cell), 1cell (Lte1CellTestbed)", scenarios);
+  cmd.AddValue ("schedulers", "Comma separated event queues: map, heap, list, calendar or default", schedulers);
+  cmd.AddValue ("simTime", "Simulated seconds of every run", simTime);
+  cmd.AddValue ("repeat", "Runs of every point", repeat);
+  cmd.AddValue ("maxUes", "Skip the points with more users in total, 0 for no limit", maxUes);
+  cmd.AddValue ("timeout", "Wall seconds after which a run is stopped, 0 for no limit", timeout);
+  cmd.AddValue ("jobs", "Maximum number of concurrent runs [Default=1, for undisturbed timings]", jobs);
+  cmd.AddValue ("fastExit", "Run with --fastExit=1, leaving the teardown out of wall_s", fastExit);
+  cmd.AddValue ("tracePath", "Fading trace of every run, empty for no fading", tracePath);
+  cmd.AddValue ("testbedProgram", "Path of the Lte4CellTestbed executable", testbedProgram);
+  cmd.AddValue ("watsonProgram", "Path of the LteWatson executable", watsonProgram);
+  cmd.AddValue ("oneCellProgram", "Path of the Lte1CellTestbed executable", oneCellProgram);
+  cmd.AddValue ("extraArgs", "Space separated arguments passed unchanged to every run", extraArgs);
+  cmd.AddValue ("outDir", "Directory holding one sub-directory per run and the CSV", outDir);
+  cmd.AddValue ("csv", "Result file [Default=<outDir>/benchmark.csv]", csv);
+  cmd.AddValue ("label", "First column of every row, e.g. the commit being measured", label);
+  cmd.AddValue ("append", "Add the rows to an existing CSV instead of replacing it", append);
+  cmd.Parse (argc, argv);
+
+  if (jobs == 0)
+    {
+      jobs = 1;
+    }
+  if (repeat == 0)
+    {
+      repeat = 1;
+    }
+  tracePath = AbsolutePath (tracePath);
+  std::vector<uint32_t> uesAxis = SplitNumbers (uesPerCell);
+  std::vector<uint32_t> cellsAxis = SplitNumbers (cells);
+  std::vector<std::string> scenarioAxis = SplitString (scenarios, ',');
+  std::vector<std::string> schedulerAxis = SplitString (schedulers, ',');
+  std::vector<std::string> extra = SplitString (extraArgs, ' ');
+
+  MakeDirectory (outDir);
+  outDir = AbsolutePath (outDir);
+  csv = csv.empty () ? outDir + "/benchmark.csv" : AbsolutePath (csv);
+
+  // Expand the grid: scenario, then scheduler, then cells, then users per
+  // cell, then repeat
+  std::vector<BenchmarkRun> runs;
+  for (uint32_t s = 0; s < scenarioAxis.size (); s++)
+    {
+      const std::string &scenario = scenarioAxis[s];
+      if (scenario != "testbed" && scenario != "watson" && scenario != "1cell")
+        {
+          NS_FATAL_ERROR ("Unknown scenario " << scenario << ", use testbed, watson or 1cell");
+        }
+      std::string program = AbsolutePath (ScenarioProgram (scenario, testbedProgram, watsonProgram, oneCellProgram));
+      if (access (program.c_str (), X_OK) != 0)
+        {
+          NS_FATAL_ERROR ("Can't execute " << program << ", use --"
+                          << (scenario == "1cell" ? "oneCell" : scenario) << "Program");
+        }
+      for (uint32_t q = 0; q < schedulerAxis.size (); q++)
+        {
+          for (uint32_t c = 0; c < cellsAxis.size (); c++)
+            {
+              if (cellsAxis[c] == 0 || (scenario != "testbed" && cellsAxis[c] != 1))
+                {
+                  continue;
+                }
+              for (uint32_t u = 0; u < uesAxis.size (); u++)
+                {
+                  if (maxUes > 0 && cellsAxis[c] * uesAxis[u] > maxUes)
+                    {
+                      std::cout << "Skipping " << scenario << " " << cellsAxis[c] << " cells x "
+                                << uesAxis[u] << " users (--maxUes=" << maxUes << ")" << std::endl;
+                      continue;
+                    }
+                  for (uint32_t k = 0; k < repeat; k++)
+                    {
+                      BenchmarkRun run;
+                      run.id = runs.size ();
+                      run.scenario = scenario;
+                      run.scheduler = schedulerAxis[q];
+                      run.cells = cellsAxis[c];
+                      run.uesPerCell = uesAxis[u];
+                      run.repeat = k;
+                      run.pid = -1;
+                      run.status = 0;
+                      run.startTime = 0;
+                      run.wallTime = 0;
+                      run.peakRssKb = 0;
+                      run.runWallTime = -1;
+                      run.events = -1;
+                      run.simTime = -1;
+                      std::ostringstream dir;
+                      dir << outDir << "/run-" << std::setw (4) << std::setfill ('0') << run.id;
+                      run.dir = dir.str ();
+                      runs.push_back (run);
+                    }
+                }
+            }
+        }
+    }
+
+  uint32_t nRuns = runs.size ();
+  std::cout << "Benchmark of " << nRuns << " runs, " << jobs << " at a time, in " << outDir << std::endl;
+
+  double benchmarkStart = WallClockSeconds ();
+  uint32_t next = 0;
+  uint32_t nRunning = 0;
+  uint32_t nDone = 0;
+  uint32_t nFailed = 0;
+  while (nDone < nRuns)
+    {
+      while (nRunning < jobs && next < nRuns)
+        {
+          BenchmarkRun &run = runs[next++];
+          MakeDirectory (run.dir);
+
+          std::ostringstream simTimeArg;
+          simTimeArg << "--simTime=" << simTime;
+          std::vector<std::string> args;
+          if (run.scenario == "testbed")
+            {
+              WriteTopology (run.dir + "/topology.cfg", run.cells, run.uesPerCell);
+              args.push_back (AbsolutePath (testbedProgram));
+              args.push_back ("--topology=topology.cfg");
+              args.push_back ("--tracePath=" + tracePath);
+            }
+          else if (run.scenario == "watson")
+            {
+              std::ostringstream nUesArg;
+              nUesArg << "--nUes=" << run.uesPerCell;
+              args.push_back (AbsolutePath (watsonProgram));
+              args.push_back (nUesArg.str ());
+              args.push_back (tracePath.empty () ? "--fading=0" : "--tracePath=" + tracePath);
+            }
+          else
+            {
+              // Only the users vary, the channel and ConfigStore defaults are its own
+              std::ostringstream mobileArg, staticArg;
+              mobileArg << "--nMobileUes=" << run.uesPerCell / 2;
+              staticArg << "--nStaticUes=" << run.uesPerCell - run.uesPerCell / 2;
+              args.push_back (AbsolutePath (oneCellProgram));
+              args.push_back (mobileArg.str ());
+              args.push_back (staticArg.str ());
+            }
+          args.push_back (simTimeArg.str ());
+          if (run.scheduler != "default")
+            {
+              args.push_back ("--scheduler=" + run.scheduler);
+            }
+          args.push_back (fastExit ? "--fastExit=1" : "--fastExit=0");
+          args.insert (args.end (), extra.begin (), extra.end ());
+
+          run.startTime = WallClockSeconds ();
+          run.pid = StartIsolatedRun (run.dir, args, timeout);
+          nRunning++;
+        }
+
+      int status;
+      struct rusage ru;
+      pid_t pid = wait4 (-1, &status, 0, &ru);
+      if (pid < 0)
+        {
+          if (errno == EINTR)
+            {
+              continue;
+            }
+          NS_FATAL_ERROR ("wait4 failed: " << std::strerror (errno));
+        }
+      for (uint32_t r = 0; r < nRuns; r++)
+        {
+          if (runs[r].pid == pid)
+            {
+              BenchmarkRun &run = runs[r];
+              run.status = status;
+              run.wallTime = WallClockSeconds () - run.startTime;
+#ifdef __APPLE__
+              run.peakRssKb = ru.ru_maxrss / 1024;   // bytes on OS X
+#else
+              run.peakRssKb = ru.ru_maxrss;          // kilobytes on Linux
+#endif
+              run.pid = -1;
+              ReadPhaseTimes (run);
+              nRunning--;
+              nDone++;
+              std::string result = RunStatus (run);
+              if (result != "ok")
+                {
+                  nFailed++;
+                }
+              std::cout << "[" << nDone << "/" << nRuns << "] " << run.scenario << " (" << run.scheduler << ") " << run.cells
+                        << " cells x " << run.uesPerCell << " users: " << result << ", "
+                        << run.wallTime << " s, " << run.peakRssKb << " KB" << std::endl;
+              break;
+            }
+        }
+    }
+  std::cout << "Benchmark finished in " << WallClockSeconds () - benchmarkStart
+            << " s, " << nFailed << " failed run(s)" << std::endl;
+
+  // Header only at the top of a new file, so that appended runs stay one table
+  bool newFile = !append || access (csv.c_str (), F_OK) != 0;
+  std::ofstream csvFile (csv.c_str (), append ? std::ios_base::app : std::ios_base::trunc);
+  if (!csvFile.is_open ())
+    {
+      NS_FATAL_ERROR ("Can't open " << csv);
+    }
+  if (newFile)
+    {
+      csvFile << CSV_HEADER << '\n';
+    }
+  for (uint32_t r = 0; r < nRuns; r++)
+    {
+      WriteCsvRow (csvFile, label, runs[r]);
+    }
+  csvFile.close ();
+  std::cout << "Results in " << csv << std::endl;
+
+  return nFailed == 0 ? 0 : 1;
+}
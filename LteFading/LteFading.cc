@@ -10,6 +10,13 @@
 #include "ns3/applications-module.h"
 #include "ns3/internet-module.h"
 
+#include "../fading-traces/mmap-trace-fading-loss-model.h"
+#include "../common/event-profiler.h"
+#include "../common/fast-exit.h"
+#include "../common/phase-timer.h"
+#include "../common/scenario-builder.h"
+#include "../common/scheduler-type.h"
+
 
 using namespace ns3;
 
@@ -18,85 +25,7 @@ NS_LOG_COMPONENT_DEFINE( "LteModel0" );
 // Definitions for Mobility Tracking -- comment to disable trace
 // #define ENABLE_MOBILITY_TRACKING
 
-#ifdef ENABLE_MOBILITY_TRACKING
-static void CourseChange (std::string traceStr, Ptr<const MobilityModel> mobility) {
-  Vector pos = mobility->GetPosition ();
-  Vector vel = mobility->GetVelocity ();
-  std::cout << Simulator::Now ()
-            << " Trace:" << traceStr << "    "
-            << " POS: (" << pos.x << "," << pos.y << "," << pos.z << ")"
-            << " VEL: (" << vel.x << "," << vel.y << "," << vel.z << ")" << std::endl;
-}
-
-static void ReportPosition( Ptr<Node> thisNode ) {
-    Vector pos = thisNode->GetObject<MobilityModel>()->GetPosition();
-    Vector vel = thisNode->GetObject<MobilityModel>()->GetVelocity();
-    std::cout << Simulator::Now()
-              << " Node#" << thisNode->GetId()
-              << " POS: (" << pos.x << "," << pos.y << "," << pos.z << ")"
-              << " VEL: (" << vel.x << "," << vel.y << "," << vel.z << ")"
-              << std::endl;
-}
-#endif
-
-void
-PrintGnuplottableUeListToFile (std::string filename)
-{
-  std::ofstream outFile;
-  outFile.open (filename.c_str (), std::ios_base::out | std::ios_base::trunc);
-  if (!outFile.is_open ())
-    {
-      NS_LOG_ERROR ("Can't open file " << filename);
-      return;
-    }
-  for (NodeList::Iterator it = NodeList::Begin (); it != NodeList::End (); ++it)
-    {
-      Ptr<Node> node = *it;
-      int nDevs = node->GetNDevices ();
-      for (int j = 0; j < nDevs; j++)
-        {
-          Ptr<LteUeNetDevice> uedev = node->GetDevice (j)->GetObject <LteUeNetDevice> ();
-          if (uedev)
-            {
-              Vector pos = node->GetObject<MobilityModel> ()->GetPosition ();
-              outFile << "set label \"" << uedev->GetImsi ()
-                      << "\" at "<< pos.x << "," << pos.y << " left font \"Helvetica,4\" textcolor rgb \"grey\" front point pt 1 ps 0.3 lc rgb \"grey\" offset 0,0"
-                      << std::endl;
-            }
-        }
-    }
-}
-
-void
-PrintGnuplottableEnbListToFile (std::string filename)
-{
-  std::ofstream outFile;
-  outFile.open (filename.c_str (), std::ios_base::out | std::ios_base::trunc);
-  if (!outFile.is_open ())
-    {
-      NS_LOG_ERROR ("Can't open file " << filename);
-      return;
-    }
-  for (NodeList::Iterator it = NodeList::Begin (); it != NodeList::End (); ++it)
-    {
-      Ptr<Node> node = *it;
-      int nDevs = node->GetNDevices ();
-      for (int j = 0; j < nDevs; j++)
-        {
-          Ptr<LteEnbNetDevice> enbdev = node->GetDevice (j)->GetObject <LteEnbNetDevice> ();
-          if (enbdev)
-            {
-              Vector pos = node->GetObject<MobilityModel> ()->GetPosition ();
-              outFile << "set label \"" << enbdev->GetCellId ()
-                      << "\" at "<< pos.x << "," << pos.y
-                      << " left font \"Helvetica,4\" textcolor rgb \"white\" front  point pt 2 ps 0.3 lc rgb \"white\" offset 0,0"
-                      << std::endl;
-            }
-        }
-    }
-}
-
-int main(int argc, char const *argv[]) {
+int main(int argc, char *argv[]) {
 
     double enbX = 0.00, enbY = 0.00, enbZ = 30.00;  // Base Station Position in canvas
     double ueMaxRadius  = 1000.00;  // Radius around eNodeB for users to allocate positions and waypoints
@@ -106,9 +35,27 @@ int main(int argc, char const *argv[]) {
     uint32_t simDuration = 5;  // In Seconds
 
 
+    // Command line
+    bool fastExit = false;
+    bool profileEvents = false;
+    std::string scheduler = "";
+    std::string tracePath = "../../src/lte/model/fading-traces/fading_trace_ETU_3kmph.fad";
+    bool gnuplotLabels = false;
+    CommandLine cmd;
+    cmd.AddValue( "fastExit", "Flush the traces and exit without tearing down the simulation", fastExit );
+    cmd.AddValue( "profileEvents", "Count and time the events by target, ranked in EventProfile.txt", profileEvents );
+    cmd.AddValue( "scheduler", "Event queue: map, heap, list or calendar [Default: ns-3 SchedulerType]", scheduler );
+    cmd.AddValue( "tracePath", "Fading trace (.fad, or .fadb to map it)", tracePath );
+    cmd.AddValue( "gnuplotLabels", "Write the eNB and UE positions as gnuplot labels (enbs.txt, ues.txt)", gnuplotLabels );
+    cmd.Parse( argc, argv );
+    FastExit::Enable( fastExit );
+    SelectScheduler( scheduler );
+    EventProfiler::Enable( profileEvents );
+
     // Setup time resolution
     Time::SetResolution( Time::NS );
 
+    PhaseTimer::Get().Begin( "nodes" );
     // Create eNodeBs
     NS_LOG_INFO( "Creating eNodeB nodes..." );
     NodeContainer eNodeBs;  eNodeBs.Create(1);
@@ -119,7 +66,10 @@ int main(int argc, char const *argv[]) {
     NS_LOG_INFO( "Creating a single remote node..." );
     NodeContainer remoteNode;   remoteNode.Create(1);
 
+    PhaseTimer::Get().End();
+
     // ####################   SETUP MOBILTY MODELS FOR SIMUALTION ##############
+    PhaseTimer::Get().Begin( "mobility" );
 
 
     NS_LOG_INFO( "Setting up mobility model..." );
@@ -152,84 +102,45 @@ int main(int argc, char const *argv[]) {
 
 
 
-    #ifdef ENABLE_MOBILITY_TRACKING
-        // Enable tracing the UE positions
-        Config::Connect( "/NodeList/*/$ns3::MobilityModel/CourseChange", MakeCallback (&CourseChange) );
-        // Create events every second to report back the current position of UEs
-        for( uint32_t ueIdx = 0; ueIdx < 2; ueIdx ++ ) {
-            for( uint32_t stepIdx = 0; stepIdx < simDuration; stepIdx++ ) {
-                Simulator::Schedule( Time(Seconds(stepIdx)), ReportPosition, ueNodes.Get(ueIdx) );
-            }
-        }
-    #endif
+#ifdef ENABLE_MOBILITY_TRACKING
+    // Print course changes and the positions of the UEs every second
+    EnableMobilityTracking( ueNodes );
+#endif
+    PhaseTimer::Get().End();
     // ######################## END OF MOBILITY SETUP ##########################
 
     // ########################## LTE NETWORK SETUP ############################
-    // Create an Lte Helper
-    Ptr<LteHelper> lteHelper    = CreateObject<LteHelper>();
+    // Create an Lte Helper with its EPC
+    LteScenarioBuilder scenario;
+    Ptr<LteHelper> lteHelper    = scenario.GetLteHelper();
 
     //Setting Fading Model
     //Fading trace configuration
      NS_LOG_INFO("Fading model settings");
 
-    lteHelper->SetFadingModel("ns3::TraceFadingLossModel");
-
-    lteHelper->SetFadingModelAttribute ("TraceFilename", StringValue ("../../src/lte/model/fading-traces/fading_trace_ETU_3kmph.fad"));
-
-
+    SetTraceFadingModel( lteHelper, tracePath );
 
-    lteHelper->SetFadingModelAttribute ("TraceLength", TimeValue (Seconds (10.0)));
-    lteHelper->SetFadingModelAttribute ("SamplesNum", UintegerValue (10000));
-    lteHelper->SetFadingModelAttribute ("WindowSize", TimeValue (Seconds (0.5)));
-    lteHelper->SetFadingModelAttribute ("RbNum", UintegerValue (100));
 
+    Ptr<Node> pgwNode   = scenario.GetPgwNode();
 
-    Ptr<PointToPointEpcHelper> epcHelper    = CreateObject<PointToPointEpcHelper>();
-    lteHelper->SetEpcHelper( epcHelper );   // Install EPC Helper to LTE
-    Ptr<Node> pgwNode   = epcHelper->GetPgwNode();
-
-    // Set up remote node for internet access
-    InternetStackHelper inetHelper; inetHelper.Install( remoteNode );
-
-    // Create a Point To Point link between ENB's PGW and remote node
-    PointToPointHelper p2pHelper;
-    p2pHelper.SetDeviceAttribute( "DataRate", DataRateValue(DataRate("100Gb/s")) );
-    p2pHelper.SetDeviceAttribute( "Mtu", UintegerValue(1500) );
-    p2pHelper.SetChannelAttribute( "Delay", TimeValue(Seconds(0.010)) );
-    NetDeviceContainer inetDev = p2pHelper.Install( pgwNode, remoteNode.Get(0) );
-
-    // Assign IP addresses
-    Ipv4AddressHelper ipv4Helper;
-    ipv4Helper.SetBase( "1.0.0.0", "255.0.0.0" );
-    Ipv4InterfaceContainer ipv4interfaces = ipv4Helper.Assign( inetDev );
-
-    // State the routing
-    Ipv4StaticRoutingHelper ipv4RoutingHelper;
-    Ptr<Ipv4StaticRouting> remoteNodeStaticRouting = ipv4RoutingHelper.GetStaticRouting( remoteNode.Get(0)->GetObject<Ipv4>() );
-    remoteNodeStaticRouting->AddNetworkRouteTo( Ipv4Address("7.0.0.0"), Ipv4Mask("255.0.0.0"), 1 );
+    // Connect the remote node to the PGW (1.0.0.0/16) with a route to the UEs (7.0.0.0/8)
+    scenario.InstallRemoteHosts( remoteNode );
 
     // Install LTE Network device at eNodeBs
     NS_LOG_INFO( "Installing LTE network device at eNodeB" );
-    NetDeviceContainer enbDevs  = lteHelper->InstallEnbDevice( eNodeBs );
+    NetDeviceContainer enbDevs  = scenario.InstallEnbDevices( eNodeBs );
     // Install LTE Network device at ueNodes
     NS_LOG_INFO( "Installing LTE network device at UE" );
-    NetDeviceContainer ueDevs   = lteHelper->InstallUeDevice( ueNodes );
+    NetDeviceContainer ueDevs   = scenario.InstallUeDevices( ueNodes );
 
-    NS_LOG_INFO( "Installing Internet Stack on UEs..." );
-    // Install Internet Stack to UEs
-    inetHelper.Install( ueNodes );
+    // Install Internet Stack, IP addresses and default routes on UEs
+    NS_LOG_INFO( "Setting up Internet on UEs..." );
+    Ipv4InterfaceContainer ueIpInf = scenario.InstallUeInternet( ueNodes, ueDevs );
 
-    // assign IP addresses to UEs and add apps
-    NS_LOG_INFO( "Assigning IP Addresses to UEs..." );
-    Ipv4InterfaceContainer ueIpInf = epcHelper->AssignUeIpv4Address( ueDevs );
+    // Add apps
     uint16_t dlPort = 1729;
     for( uint32_t idx = 0; idx < ueNodes.GetN(); idx++ ) {
         Ptr<Node> thisUe    = ueNodes.Get( idx );
-        Ptr<NetDevice> thisUeDev = ueDevs.Get( idx );
-        // Setup default gateway
-        Ptr<Ipv4StaticRouting>ueNodeStaticRouting = ipv4RoutingHelper.GetStaticRouting( thisUe->GetObject<Ipv4>() );
-        ueNodeStaticRouting->SetDefaultRoute( epcHelper->GetUeDefaultGatewayAddress(), 1 );
-        // Add Apps
         PacketSinkHelper packetSinkHelper( "ns3::UdpSocketFactory", InetSocketAddress(Ipv4Address::GetAny(),dlPort) );
         ApplicationContainer serverApps = packetSinkHelper.Install( thisUe );
         serverApps.Start( Seconds(0.01) );
@@ -240,7 +151,7 @@ int main(int argc, char const *argv[]) {
 
     // Attach UEs to eNodeB
     NS_LOG_INFO( "Attaching UEs to eNodeB" );
-    lteHelper->Attach( ueDevs, enbDevs.Get(0) );
+    scenario.Attach( ueDevs, enbDevs.Get(0) );
 
     // Get IP address of all nodes
     std::cout << "IP v4 Addresses: " << std::endl
@@ -284,18 +195,32 @@ int main(int argc, char const *argv[]) {
     // ########################### END OF APP SETUP ############################
 
     lteHelper->EnableTraces();
+    FastExit::AddLteStats( lteHelper );
 
-    // Ptr<RadioEnvironmentMapHelper> remHelper;
-    // PrintGnuplottableEnbListToFile( "enbs.txt" );
-    // PrintGnuplottableUeListToFile( "ues.txt" );
+    // Radio environment map: see LteRem
+    if( gnuplotLabels ) {
+        scenario.GetDeviceRegistry().PrintGnuplottableEnbListToFile( "enbs.txt" );
+        scenario.GetDeviceRegistry().PrintGnuplottableUeListToFile( "ues.txt" );
+    }
 
     Simulator::Stop( Seconds(simDuration) );
 
     NS_LOG_INFO( "Starting Simulator..." );
+    PhaseTimer::Get().Begin( "run" );
     Simulator::Run();
+    PhaseTimer::Get().End();
+    EventProfiler::Report( "EventProfile.txt" );    // only with --profileEvents
     NS_LOG_INFO( "Stoping Simulator..." );
 
-    Simulator::Destroy();
+    PhaseTimer::Get().Begin( "destroy" );
+    FastExit::Destroy();    // only flushes with --fastExit
+    PhaseTimer::Get().End();
+
+    // Wall time and peak memory of each phase
+    PhaseTimer::Get().Print( std::cout );
+    PhaseTimer::Get().WriteJson( "PhaseTimes.json" );
+
+    FastExit::Exit( 0 );    // no teardown with --fastExit
 
     return 0;
 }
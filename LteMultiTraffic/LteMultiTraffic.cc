@@ -11,6 +11,14 @@
 #include "ns3/applications-module.h"
 #include "ns3/internet-module.h"
 
+#include "../common/event-profiler.h"
+#include "../common/fast-exit.h"
+#include "../common/phase-timer.h"
+#include "../common/scenario-builder.h"
+
+#include "../common/scheduler-type.h"
+#include "../common/ue-measurement-recorder.h"
+
 using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE( "LteMultiTraffic" );
@@ -18,41 +26,7 @@ NS_LOG_COMPONENT_DEFINE( "LteMultiTraffic" );
 // Definitions for Mobility Tracking -- comment to disable trace
 // #define ENABLE_MOBILITY_TRACKING
 
-#ifdef ENABLE_MOBILITY_TRACKING
-static void CourseChange (std::string traceStr, Ptr<const MobilityModel> mobility) {
-  Vector pos = mobility->GetPosition ();
-  Vector vel = mobility->GetVelocity ();
-  std::cout << Simulator::Now ()
-            << " Trace:" << traceStr << "    "
-            << " POS: (" << pos.x << "," << pos.y << "," << pos.z << ")"
-            << " VEL: (" << vel.x << "," << vel.y << "," << vel.z << ")" << std::endl;
-}
-
-static void ReportPosition( Ptr<Node> thisNode ) {
-    Vector pos = thisNode->GetObject<MobilityModel>()->GetPosition();
-    Vector vel = thisNode->GetObject<MobilityModel>()->GetVelocity();
-    std::cout << Simulator::Now()
-              << " Node#" << thisNode->GetId()
-              << " POS: (" << pos.x << "," << pos.y << "," << pos.z << ")"
-              << " VEL: (" << vel.x << "," << vel.y << "," << vel.z << ")"
-              << std::endl;
-}
-#endif
-
-
-std::stringstream ue1LogStream;
-std::stringstream ue2LogStream;
-static void ReportUeMeasurements( std::string traceStr, uint16_t cellId, uint16_t rnti, double rsrp, double sinr ) {
-
-    // Divide the stream to ue1 and ue2
-    if( rnti == 1 ) {
-        ue1LogStream << Simulator::Now ().GetNanoSeconds () / (double) 1e9 << "\t" << rsrp << "\t" << sinr << "\n";
-    } else if( rnti == 2 ) {
-        ue2LogStream << Simulator::Now ().GetNanoSeconds () / (double) 1e9 << "\t" << rsrp << "\t" << sinr << "\n";
-    }
-}
-
-int main(int argc, char const *argv[]) {
+int main(int argc, char *argv[]) {
 
     double enbX = 0.00, enbY = 0.00, enbZ = 30.00;  // Base Station Position in canvas
     double ueMaxRadius  = 1000.00;  // Radius around eNodeB for users to allocate positions and waypoints
@@ -70,9 +44,23 @@ int main(int argc, char const *argv[]) {
     Time startTime_FTPSrcApp        = Seconds(1.10);
     Time startTime_FTPSnkApp        = Seconds(1.00);
 
+    // Command line
+    bool fastExit = false;
+    bool profileEvents = false;
+    std::string scheduler = "";
+    CommandLine cmd;
+    cmd.AddValue( "fastExit", "Flush the traces and exit without tearing down the simulation", fastExit );
+    cmd.AddValue( "profileEvents", "Count and time the events by target, ranked in EventProfile.txt", profileEvents );
+    cmd.AddValue( "scheduler", "Event queue: map, heap, list or calendar [Default: ns-3 SchedulerType]", scheduler );
+    cmd.Parse( argc, argv );
+    FastExit::Enable( fastExit );
+    SelectScheduler( scheduler );
+    EventProfiler::Enable( profileEvents );
+
     // Setup time resolution
     Time::SetResolution( Time::NS );
 
+    PhaseTimer::Get().Begin( "nodes" );
     // Create eNodeBs
     NS_LOG_INFO( "Creating eNodeB nodes..." );
     NodeContainer eNodeBs;  eNodeBs.Create(1);
@@ -83,7 +71,10 @@ int main(int argc, char const *argv[]) {
     NS_LOG_INFO( "Creating a single remote node..." );
     NodeContainer remoteNode;   remoteNode.Create(1);
 
+    PhaseTimer::Get().End();
+
     // ####################   SETUP MOBILTY MODELS FOR SIMUALTION ##############
+    PhaseTimer::Get().Begin( "mobility" );
     // NS_LOG_INFO( "Setting up mobility model..." );
     // MobilityHelper  mobModel;
     // mobModel.SetMobilityModel( "ns3::ConstantPositionMobilityModel" );  mobModel.Install( eNodeBs );
@@ -117,23 +108,17 @@ int main(int argc, char const *argv[]) {
     ueMobility.Install( ueNodes );
 
 #ifdef ENABLE_MOBILITY_TRACKING
-    // Enable tracing the UE positions
-    Config::Connect( "/NodeList/*/$ns3::MobilityModel/CourseChange", MakeCallback (&CourseChange) );
-    // Create events every second to report back the current position of UEs
-    for( uint32_t ueIdx = 0; ueIdx < 2; ueIdx ++ ) {
-        for( uint32_t stepIdx = 0; stepIdx < simDuration; stepIdx++ ) {
-            Simulator::Schedule( Time(Seconds(stepIdx)), ReportPosition, ueNodes.Get(ueIdx) );
-        }
-    }
+    // Print course changes and the positions of the UEs every second
+    EnableMobilityTracking( ueNodes );
 #endif
+    PhaseTimer::Get().End();
     // ######################## END OF MOBILITY SETUP ##########################
 
     // ########################## LTE NETWORK SETUP ############################
-    // Create an Lte Helper
-    Ptr<LteHelper> lteHelper    = CreateObject<LteHelper>();
-    Ptr<PointToPointEpcHelper> epcHelper    = CreateObject<PointToPointEpcHelper>();
-    lteHelper->SetEpcHelper( epcHelper );   // Install EPC Helper to LTE
-    Ptr<Node> pgwNode   = epcHelper->GetPgwNode();
+    // Create an Lte Helper with its EPC
+    LteScenarioBuilder scenario;
+    Ptr<LteHelper> lteHelper    = scenario.GetLteHelper();
+    Ptr<Node> pgwNode   = scenario.GetPgwNode();
 
     lteHelper->SetFadingModel("ns3::TraceFadingLossModel");
     lteHelper->SetFadingModelAttribute ("TraceFilename", StringValue ("../../src/lte/model/fading-traces/fading_trace_ETU_3kmph.fad"));
@@ -142,51 +127,23 @@ int main(int argc, char const *argv[]) {
     lteHelper->SetFadingModelAttribute ("WindowSize", TimeValue (Seconds (0.5)));
     lteHelper->SetFadingModelAttribute ("RbNum", UintegerValue (100));
 
-    // Set up remote node for internet access
-    InternetStackHelper inetHelper; inetHelper.Install( remoteNode );
-
-    // Create a Point To Point link between ENB's PGW and remote node
-    PointToPointHelper p2pHelper;
-    p2pHelper.SetDeviceAttribute( "DataRate", DataRateValue(DataRate("100Gb/s")) );
-    p2pHelper.SetDeviceAttribute( "Mtu", UintegerValue(1500) );
-    p2pHelper.SetChannelAttribute( "Delay", TimeValue(Seconds(0.010)) );
-    NetDeviceContainer inetDev = p2pHelper.Install( pgwNode, remoteNode.Get(0) );
-
-    // Assign IP addresses
-    Ipv4AddressHelper ipv4Helper;
-    ipv4Helper.SetBase( "1.0.0.0", "255.0.0.0" );
-    Ipv4InterfaceContainer ipv4interfaces = ipv4Helper.Assign( inetDev );
-
-    // State the routing
-    Ipv4StaticRoutingHelper ipv4RoutingHelper;
-    Ptr<Ipv4StaticRouting> remoteNodeStaticRouting = ipv4RoutingHelper.GetStaticRouting( remoteNode.Get(0)->GetObject<Ipv4>() );
-    remoteNodeStaticRouting->AddNetworkRouteTo( Ipv4Address("7.0.0.0"), Ipv4Mask("255.0.0.0"), 1 );
+    // Connect the remote node to the PGW (1.0.0.0/16) with a route to the UEs (7.0.0.0/8)
+    scenario.InstallRemoteHosts( remoteNode );
 
     // Install LTE Network device at eNodeBs
     NS_LOG_INFO( "Installing LTE network device at eNodeB" );
-    NetDeviceContainer enbDevs  = lteHelper->InstallEnbDevice( eNodeBs );
+    NetDeviceContainer enbDevs  = scenario.InstallEnbDevices( eNodeBs );
     // Install LTE Network device at ueNodes
     NS_LOG_INFO( "Installing LTE network device at UE" );
-    NetDeviceContainer ueDevs   = lteHelper->InstallUeDevice( ueNodes );
-
-    NS_LOG_INFO( "Installing Internet Stack on UEs..." );
-    // Install Internet Stack to UEs
-    inetHelper.Install( ueNodes );
-
-    // assign IP addresses to UEs and add apps
-    NS_LOG_INFO( "Assigning IP Addresses to UEs..." );
-    Ipv4InterfaceContainer ueIpInf = epcHelper->AssignUeIpv4Address( ueDevs );
-    for( uint32_t idx = 0; idx < ueNodes.GetN(); idx++ ) {
-        Ptr<Node> thisUe    = ueNodes.Get( idx );
-        Ptr<NetDevice> thisUeDev = ueDevs.Get( idx );
-        // Setup default gateway
-        Ptr<Ipv4StaticRouting>ueNodeStaticRouting = ipv4RoutingHelper.GetStaticRouting( thisUe->GetObject<Ipv4>() );
-        ueNodeStaticRouting->SetDefaultRoute( epcHelper->GetUeDefaultGatewayAddress(), 1 );
-    }
+    NetDeviceContainer ueDevs   = scenario.InstallUeDevices( ueNodes );
+
+    // Install Internet Stack, IP addresses and default routes on UEs
+    NS_LOG_INFO( "Setting up Internet on UEs..." );
+    scenario.InstallUeInternet( ueNodes, ueDevs );
 
     // Attach UEs to eNodeB
     NS_LOG_INFO( "Attaching UEs to eNodeB" );
-    lteHelper->Attach( ueDevs, enbDevs.Get(0) );
+    scenario.Attach( ueDevs, enbDevs.Get(0) );
 
     // Get IP address of all nodes
     std::cout << "IP v4 Addresses: " << std::endl
@@ -196,7 +153,9 @@ int main(int argc, char const *argv[]) {
               << "    PGW        : " << pgwNode->GetObject<Ipv4>()->GetAddress(1,0).GetLocal() << std::endl;
 
     // Enable tracing functionality for UE
-    Config::Connect( "/NodeList/*/DeviceList/0/LteUePhy/ReportCurrentCellRsrpSinr", MakeCallback(&ReportUeMeasurements) );
+    // Per UE RSRP/SINR traces (ue<rnti>Traces.txt), written while running
+    UeMeasurementRecorder ueMeasurements;
+    ueMeasurements.Connect( scenario.GetDeviceRegistry() );
 
     // ####################### END OF LTE SETUP ################################
 
@@ -302,20 +261,29 @@ int main(int argc, char const *argv[]) {
     // Enable LTE Traces
     NS_LOG_INFO( "Enabling LTE Traces..." );
     lteHelper->EnableTraces();
+    FastExit::AddLteStats( lteHelper );
 
     Simulator::Stop( simDuration );
 
     NS_LOG_INFO( "Starting Simulator..." );
+    PhaseTimer::Get().Begin( "run" );
     Simulator::Run();
+    PhaseTimer::Get().End();
+    EventProfiler::Report( "EventProfile.txt" );    // only with --profileEvents
     NS_LOG_INFO( "Stoping Simulator..." );
 
-    // Save the UE traces
-    std::ofstream ue1File( "ue1Traces.txt", std::ios::in|std::ios::trunc );
-    ue1File << ue1LogStream.str();    ue1File.close();
-    std::ofstream ue2File( "ue2Traces.txt", std::ios::in|std::ios::trunc );
-    ue2File << ue2LogStream.str();    ue2File.close();
+    // Flush the UE traces
+    ueMeasurements.Stop();
+
+    PhaseTimer::Get().Begin( "destroy" );
+    FastExit::Destroy();    // only flushes with --fastExit
+    PhaseTimer::Get().End();
+
+    // Wall time and peak memory of each phase
+    PhaseTimer::Get().Print( std::cout );
+    PhaseTimer::Get().WriteJson( "PhaseTimes.json" );
 
-    Simulator::Destroy();
+    FastExit::Exit( 0 );    // no teardown with --fastExit
 
     return 0;
 }
@@ -0,0 +1,451 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Downlink radio environment map of a hex-grid layout, computed on all cores
+// without building the LTE stack or running the simulator.
+//
+// The eNB layout comes from a topology file (common/hex-grid-topology.h), the
+// radio settings from the ns-3 defaults, so the ones of a scenario are picked
+// up from its ConfigStore file or the command line:
+//  - pathloss:  ns3::LteHelper::PathlossModel and the attributes of the model
+//               (e.g. --ns3::OkumuraHataPropagationLossModel::Environment=Urban),
+//               its Frequency set from ns3::LteEnbNetDevice::DlEarfcn as
+//               LteHelper does
+//  - power:     ns3::LteEnbPhy::TxPower over ns3::LteEnbNetDevice::DlBandwidth
+//  - noise:     ns3::LteUePhy::NoiseFigure
+// Sectors get the parabolic antennas of HexGridTopologyBuilder. Every cell
+// transmits on all RBs (full load, no fading), so the SINR of an RB is the
+// SINR of the band.
+//
+// The grid is cut in square tiles handed out to the worker threads through an
+// atomic counter. Each thread has its own pathloss model and mobility models,
+// so nothing is shared but the output raster, and evaluates a tile cell by
+// cell: the received powers of the tile are summed with RbAccumulate and the
+// SINR of the best server taken with RbSinr (common/rb-kernels.h).
+//
+// Output (the layer order is fixed, every value float32):
+//  - rem.bin, a 64 byte little-endian header followed by three nx * ny layers,
+//    x fastest: SINR [dB], RSRP of the best server [dBm], its cell ID
+//
+//      offset  size  field
+//           0     8  magic "LTEREM\0\0"
+//           8     4  version (1)
+//          12     4  header size in bytes (64), the data starts here
+//          16     4  nx
+//          20     4  ny
+//          24     4  number of layers (3)
+//          28     4  reserved
+//          32     8  xMin [m] (double)
+//          40     8  yMin [m] (double)
+//          48     8  resolution [m] (double)
+//          56     8  z [m] (double)
+//
+//  - enbs.txt and ues.txt, gnuplot labels of the eNBs (cell ID) and of the
+//    UEs of the topology (IMSI, at their initial position), in the format of
+//    LteDeviceRegistry::PrintGnuplottable*ListToFile. The UEs are dropped
+//    with the seed of this run; a scenario that draws other random numbers
+//    first puts them elsewhere.
+//
+// ./waf --run "scratch/LteRem/LteRem --topology=../Lte4CellTestbed/topology.cfg
+//     --ns3::LteHelper::PathlossModel=ns3::OkumuraHataPropagationLossModel
+//     --ns3::LteEnbPhy::TxPower=40 --ns3::LteUePhy::NoiseFigure=6" --cwd scratch/LteRem/
+//
+// and in gnuplot (layer k starts at 64 + 4 k nx ny):
+//   set view map; load "enbs.txt"
+//   plot "rem.bin" binary skip=64 array=(nx,ny) format="%float" dx=res dy=res origin=(xMin,yMin) with image
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+
+#include "ns3/antenna-module.h"
+#include "ns3/config-store-module.h"
+#include "ns3/core-module.h"
+#include "ns3/lte-spectrum-value-helper.h"
+#include "ns3/mobility-module.h"
+#include "ns3/propagation-loss-model.h"
+
+#include "../common/hex-grid-topology.h"
+#include "../common/rb-kernels.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("LteRem");
+
+namespace {
+
+struct RemRasterHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t headerSize;
+  uint32_t nx;
+  uint32_t ny;
+  uint32_t layers;
+  uint32_t reserved;
+  double xMin;
+  double yMin;
+  double resolution;
+  double z;
+};
+
+static_assert (sizeof (RemRasterHeader) == 64, "RemRasterHeader must be 64 bytes");
+
+static const char REM_RASTER_MAGIC[8] = { 'L', 'T', 'E', 'R', 'E', 'M', 0, 0 };
+
+struct RemGrid
+{
+  double xMin;
+  double yMin;
+  double resolution;
+  double z;
+  uint32_t nx;
+  uint32_t ny;
+  uint32_t tileSize;
+
+  uint32_t GetTilesX (void) const { return (nx + tileSize - 1) / tileSize; }
+  uint32_t GetTilesY (void) const { return (ny + tileSize - 1) / tileSize; }
+  uint32_t GetNTiles (void) const { return GetTilesX () * GetTilesY (); }
+};
+
+struct RemRaster
+{
+  std::vector<float> sinrDb;
+  std::vector<float> rsrpDbm;
+  std::vector<float> cellId;
+};
+
+// Current default of an attribute, as a string
+std::string
+GetDefault (std::string type, std::string attribute)
+{
+  TypeId::AttributeInformation info;
+  if (!TypeId::LookupByName (type).LookupAttributeByName (attribute, &info))
+    {
+      NS_FATAL_ERROR ("No attribute " << type << "::" << attribute);
+    }
+  return info.initialValue->SerializeToString (info.checker);
+}
+
+double
+GetDefaultDouble (std::string type, std::string attribute)
+{
+  return std::atof (GetDefault (type, attribute).c_str ());
+}
+
+/**
+ * The models of one thread. Everything is created by the main thread, the
+ * worker only moves its own receiver around, so no reference count or random
+ * stream is touched by two threads.
+ */
+class RemWorker
+{
+public:
+  RemWorker (const RemGrid &grid, const HexGridTopologyBuilder &topology,
+             ObjectFactory pathlossFactory, double frequency,
+             double txPowerDbm, uint32_t nRbs, double noiseFigureDb)
+    : m_grid (grid)
+  {
+    const HexGridTopologyConfig &c = topology.GetConfig ();
+    m_pathloss = pathlossFactory.Create<PropagationLossModel> ();
+    m_pathloss->SetAttributeFailSafe ("Frequency", DoubleValue (frequency));
+    NodeContainer enbs = topology.GetEnbNodes ();
+    for (uint32_t cell = 0; cell < enbs.GetN (); cell++)
+      {
+        Ptr<MobilityModel> enb = CreateObject<ConstantPositionMobilityModel> ();
+        enb->SetPosition (enbs.Get (cell)->GetObject<MobilityModel> ()->GetPosition ());
+        m_enbs.push_back (enb);
+        Ptr<AntennaModel> antenna;
+        if (c.sectors > 1)
+          {
+            antenna = CreateObject<ParabolicAntennaModel> ();
+            antenna->SetAttribute ("Beamwidth", DoubleValue (c.beamwidth));
+            antenna->SetAttribute ("MaxAttenuation", DoubleValue (c.maxAttenuation));
+            antenna->SetAttribute ("Orientation", DoubleValue (topology.GetOrientation (cell)));
+          }
+        m_antennas.push_back (antenna);
+        m_cellIds.push_back (topology.GetCellId (cell));
+      }
+    m_rx = CreateObject<ConstantPositionMobilityModel> ();
+
+    // all the power of a cell, RSRP is its share on one RE
+    m_txPowerDbm = txPowerDbm;
+    m_rsPowerOffsetDb = -10 * std::log10 (12.0 * nRbs);
+    double kT = 1.380649e-23 * 290;                             // W/Hz
+    m_noiseMw = kT * std::pow (10.0, noiseFigureDb / 10) * nRbs * 180e3 * 1e3;
+  }
+
+  /// Evaluate tiles until there are none left
+  void
+  Run (std::atomic<uint32_t> *nextTile, RemRaster *raster)
+  {
+    uint32_t tilePoints = m_grid.tileSize * m_grid.tileSize;
+    RbPowerVector rx (tilePoints), total (tilePoints), best (tilePoints);
+    RbPowerVector interference (tilePoints), noise (tilePoints), sinr (tilePoints);
+    noise.Fill (m_noiseMw);
+    std::vector<uint32_t> bestCell (tilePoints);
+    std::vector<Vector> points (tilePoints);
+
+    for (uint32_t tile = (*nextTile)++; tile < m_grid.GetNTiles (); tile = (*nextTile)++)
+      {
+        uint32_t x0 = (tile % m_grid.GetTilesX ()) * m_grid.tileSize;
+        uint32_t y0 = (tile / m_grid.GetTilesX ()) * m_grid.tileSize;
+        uint32_t x1 = std::min (x0 + m_grid.tileSize, m_grid.nx);
+        uint32_t y1 = std::min (y0 + m_grid.tileSize, m_grid.ny);
+        uint32_t n = 0;
+        for (uint32_t y = y0; y < y1; y++)
+          {
+            for (uint32_t x = x0; x < x1; x++)
+              {
+                points[n++] = Vector (m_grid.xMin + x * m_grid.resolution,
+                                      m_grid.yMin + y * m_grid.resolution, m_grid.z);
+              }
+          }
+
+        total.Fill (0);
+        best.Fill (0);
+        std::fill (bestCell.begin (), bestCell.end (), 0);
+        for (uint32_t cell = 0; cell < m_enbs.size (); cell++)
+          {
+            Vector enbPos = m_enbs[cell]->GetPosition ();
+            for (uint32_t p = 0; p < n; p++)
+              {
+                m_rx->SetPosition (points[p]);
+                double gainDb = m_pathloss->CalcRxPower (0, m_enbs[cell], m_rx);
+                if (m_antennas[cell])
+                  {
+                    gainDb += m_antennas[cell]->GetGainDb (Angles (points[p], enbPos));
+                  }
+                rx[p] = std::pow (10.0, (m_txPowerDbm + gainDb) / 10);
+                if (rx[p] > best[p])
+                  {
+                    best[p] = rx[p];
+                    bestCell[p] = cell;
+                  }
+              }
+            RbAccumulate (total.Data (), rx.Data (), n);
+          }
+        for (uint32_t p = 0; p < n; p++)
+          {
+            interference[p] = std::max (total[p] - best[p], 0.0);
+          }
+        RbSinr (sinr.Data (), best.Data (), interference.Data (), noise.Data (), n);
+
+        n = 0;
+        for (uint32_t y = y0; y < y1; y++)
+          {
+            for (uint32_t x = x0; x < x1; x++, n++)
+              {
+                size_t i = (size_t) y * m_grid.nx + x;
+                raster->sinrDb[i] = 10 * std::log10 (sinr[n]);
+                raster->rsrpDbm[i] = 10 * std::log10 (best[n]) + m_rsPowerOffsetDb;
+                raster->cellId[i] = m_cellIds[bestCell[n]];
+              }
+          }
+      }
+  }
+
+private:
+  RemGrid m_grid;
+  Ptr<PropagationLossModel> m_pathloss;
+  std::vector<Ptr<MobilityModel> > m_enbs;
+  std::vector<Ptr<AntennaModel> > m_antennas;
+  std::vector<uint16_t> m_cellIds;
+  Ptr<MobilityModel> m_rx;
+  double m_txPowerDbm;
+  double m_rsPowerOffsetDb;
+  double m_noiseMw;
+};
+
+bool
+WriteRaster (const std::string &filename, const RemGrid &grid, const RemRaster &raster)
+{
+  RemRasterHeader header;
+  std::memset (&header, 0, sizeof (header));
+  std::memcpy (header.magic, REM_RASTER_MAGIC, sizeof (header.magic));
+  header.version = 1;
+  header.headerSize = sizeof (header);
+  header.nx = grid.nx;
+  header.ny = grid.ny;
+  header.layers = 3;
+  header.xMin = grid.xMin;
+  header.yMin = grid.yMin;
+  header.resolution = grid.resolution;
+  header.z = grid.z;
+
+  std::FILE *file = std::fopen (filename.c_str (), "wb");
+  if (file == 0)
+    {
+      return false;
+    }
+  size_t nValues = (size_t) grid.nx * grid.ny;
+  bool ok = std::fwrite (&header, sizeof (header), 1, file) == 1
+    && std::fwrite (&raster.sinrDb[0], sizeof (float), nValues, file) == nValues
+    && std::fwrite (&raster.rsrpDbm[0], sizeof (float), nValues, file) == nValues
+    && std::fwrite (&raster.cellId[0], sizeof (float), nValues, file) == nValues;
+  return (std::fclose (file) == 0) && ok;
+}
+
+void
+WriteGnuplotLabels (const HexGridTopologyBuilder &topology)
+{
+  std::ofstream enbFile ("enbs.txt", std::ios_base::out | std::ios_base::trunc);
+  NodeContainer enbs = topology.GetEnbNodes ();
+  for (uint32_t cell = 0; cell < enbs.GetN (); cell++)
+    {
+      Vector pos = enbs.Get (cell)->GetObject<MobilityModel> ()->GetPosition ();
+      enbFile << "set label \"" << topology.GetCellId (cell)
+              << "\" at " << pos.x << "," << pos.y
+              << " left font \"Helvetica,4\" textcolor rgb \"white\" front  point pt 2 ps 0.3 lc rgb \"white\" offset 0,0"
+              << std::endl;
+    }
+
+  // IMSIs are given cell after cell, see HexGridTopologyBuilder
+  std::ofstream ueFile ("ues.txt", std::ios_base::out | std::ios_base::trunc);
+  NodeContainer ues = topology.GetUeNodes ();
+  for (uint32_t u = 0; u < ues.GetN (); u++)
+    {
+      Vector pos = ues.Get (u)->GetObject<MobilityModel> ()->GetPosition ();
+      ueFile << "set label \"" << u + 1
+             << "\" at " << pos.x << "," << pos.y
+             << " left font \"Helvetica,4\" textcolor rgb \"grey\" front point pt 1 ps 0.3 lc rgb \"grey\" offset 0,0"
+             << std::endl;
+    }
+}
+
+} // namespace
+
+int
+main (int argc, char *argv[])
+{
+  std::string topologyFile = "topology.cfg";
+  std::string output = "rem.bin";
+  double xMin = 0, xMax = 0, yMin = 0, yMax = 0;
+  double resolution = 10;
+  double z = -1;
+  uint32_t threads = std::thread::hardware_concurrency ();
+  uint32_t tileSize = 32;
+
+  CommandLine cmd;
+  cmd.AddValue ("topology", "Cell layout, see common/hex-grid-topology.h", topologyFile);
+  cmd.AddValue ("output", "Binary raster to write", output);
+  cmd.AddValue ("xMin", "West edge of the map [m] [Default: sites - 1.5 cell radius]", xMin);
+  cmd.AddValue ("xMax", "East edge of the map [m]", xMax);
+  cmd.AddValue ("yMin", "South edge of the map [m]", yMin);
+  cmd.AddValue ("yMax", "North edge of the map [m]", yMax);
+  cmd.AddValue ("resolution", "Distance between two points of the map [m]", resolution);
+  cmd.AddValue ("z", "Height of the map [m] [Default: ueHeight of the topology]", z);
+  cmd.AddValue ("threads", "Number of worker threads [Default=number of cores]", threads);
+  cmd.AddValue ("tile", "Side of the square tiles handed to the threads, in points", tileSize);
+  cmd.Parse (argc, argv);
+  ConfigStore inputConfig;
+  inputConfig.ConfigureDefaults ();
+  cmd.Parse (argc, argv);
+
+  if (resolution <= 0 || tileSize == 0)
+    {
+      NS_FATAL_ERROR ("--resolution and --tile must be positive");
+    }
+
+  HexGridTopologyConfig topologyConfig;
+  topologyConfig.Load (topologyFile);
+  HexGridTopologyBuilder topology (topologyConfig);
+  topology.CreateNodes ();
+
+  RemGrid grid;
+  if (xMin >= xMax || yMin >= yMax)
+    {
+      std::vector<Vector> sites = topologyConfig.GetSitePositions ();
+      double margin = 1.5 * topologyConfig.cellRadius;
+      xMin = yMin = 1e300;
+      xMax = yMax = -1e300;
+      for (uint32_t i = 0; i < sites.size (); i++)
+        {
+          xMin = std::min (xMin, sites[i].x - margin);
+          xMax = std::max (xMax, sites[i].x + margin);
+          yMin = std::min (yMin, sites[i].y - margin);
+          yMax = std::max (yMax, sites[i].y + margin);
+        }
+    }
+  grid.xMin = xMin;
+  grid.yMin = yMin;
+  grid.resolution = resolution;
+  grid.z = z >= 0 ? z : topologyConfig.ueHeight;
+  grid.nx = (uint32_t) std::floor ((xMax - xMin) / resolution) + 1;
+  grid.ny = (uint32_t) std::floor ((yMax - yMin) / resolution) + 1;
+  grid.tileSize = tileSize;
+
+  std::string pathlossModel = GetDefault ("ns3::LteHelper", "PathlossModel");
+  uint32_t earfcn = (uint32_t) GetDefaultDouble ("ns3::LteEnbNetDevice", "DlEarfcn");
+  uint32_t nRbs = (uint32_t) GetDefaultDouble ("ns3::LteEnbNetDevice", "DlBandwidth");
+  double txPowerDbm = GetDefaultDouble ("ns3::LteEnbPhy", "TxPower");
+  double noiseFigureDb = GetDefaultDouble ("ns3::LteUePhy", "NoiseFigure");
+  double frequency = LteSpectrumValueHelper::GetCarrierFrequency (earfcn);
+  ObjectFactory pathlossFactory;
+  pathlossFactory.SetTypeId (pathlossModel);
+
+  uint32_t numThreads = std::max (1u, std::min (threads, grid.GetNTiles ()));
+  std::cout << topology.GetNCells () << " cells, " << pathlossModel << " at " << frequency / 1e6 << " MHz, "
+            << txPowerDbm << " dBm over " << nRbs << " RBs, UE noise figure " << noiseFigureDb << " dB" << std::endl
+            << grid.nx << " x " << grid.ny << " points from (" << grid.xMin << "," << grid.yMin << ") every "
+            << grid.resolution << " m, " << grid.GetNTiles () << " tiles on " << numThreads << " threads" << std::endl;
+
+  std::vector<RemWorker> workers;
+  for (uint32_t i = 0; i < numThreads; i++)
+    {
+      workers.push_back (RemWorker (grid, topology, pathlossFactory, frequency, txPowerDbm, nRbs, noiseFigureDb));
+    }
+  RemRaster raster;
+  size_t nPoints = (size_t) grid.nx * grid.ny;
+  raster.sinrDb.resize (nPoints);
+  raster.rsrpDbm.resize (nPoints);
+  raster.cellId.resize (nPoints);
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+  std::atomic<uint32_t> nextTile (0);
+  std::vector<std::thread> workerThreads;
+  for (uint32_t i = 0; i < numThreads; i++)
+    {
+      workerThreads.push_back (std::thread (&RemWorker::Run, &workers[i], &nextTile, &raster));
+    }
+  for (uint32_t i = 0; i < workerThreads.size (); i++)
+    {
+      workerThreads[i].join ();
+    }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now () - start;
+  std::cout << nPoints * topology.GetNCells () / elapsed.count () / 1e6 << " M links/s, "
+            << elapsed.count () << " s" << std::endl;
+
+  if (!WriteRaster (output, grid, raster))
+    {
+      NS_FATAL_ERROR ("Can't write " << output);
+    }
+  WriteGnuplotLabels (topology);
+  std::cout << "Wrote " << output << ", enbs.txt and ues.txt (gnuplot: binary skip=64 array=("
+            << grid.nx << "," << grid.ny << ") format=\"%float\")" << std::endl;
+
+  Simulator::Destroy ();
+  return 0;
+}
@@ -0,0 +1,405 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Parallel parameter sweep driver for the LteWatson scenario.
+//
+// Every point of the grid (the cartesian product of all the comma separated
+// lists given below) is run as an isolated LteWatson process in its own
+// directory, with at most 'jobs' processes alive at any time. Once all the
+// runs have finished, the requested trace files are merged into a single
+// table in 'outDir', with the sweep parameters prepended to each row.
+//
+// ./waf --run "scratch/LteSweep/LteSweep --nUes=10,50,100 --ray=500,1500 --environment=Urban,SubUrban --stream=1,2,3"
+//
+// Extra arguments common to every run can be passed with --extraArgs, e.g.
+//   --extraArgs="--simTime=10 --tracePath=/abs/path/fading_trace_EVA_60kmph.fad"
+// Relative paths are resolved against the run directory, not the current one.
+// --timeout stops a run that is still going after that many wall seconds, so
+// one stuck point can't hold up the whole sweep.
+
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "ns3/core-module.h"
+
+#include "../common/isolated-run.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("LteSweep");
+
+namespace {
+
+// One axis of the sweep grid: an LteWatson argument and the values it takes
+struct SweepAxis
+{
+  std::string name;
+  std::vector<std::string> values;
+};
+
+// One point of the sweep grid and the bookkeeping of the process running it
+struct SweepRun
+{
+  uint32_t id;
+  std::vector<std::string> values;  // one per axis
+  std::string dir;
+  pid_t pid;
+  int status;
+  double startTime;
+  double wallTime;
+};
+
+std::vector<std::string>
+SplitString (const std::string &str, char delimiter)
+{
+  std::vector<std::string> tokens;
+  std::stringstream ss (str);
+  std::string token;
+  while (std::getline (ss, token, delimiter))
+    {
+      if (!token.empty ())
+        {
+          tokens.push_back (token);
+        }
+    }
+  return tokens;
+}
+
+double
+WallClockSeconds ()
+{
+  struct timeval tv;
+  gettimeofday (&tv, 0);
+  return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+std::string
+DefaultProgramPath (const char *argv0)
+{
+  // build/scratch/LteSweep/LteSweep -> build/scratch/LteWatson/LteWatson
+  std::string self (argv0);
+  std::string::size_type slash = self.rfind ('/');
+  std::string dir = (slash == std::string::npos) ? "." : self.substr (0, slash);
+  return dir + "/../LteWatson/LteWatson";
+}
+
+std::string
+AbsolutePath (const std::string &path)
+{
+  if (!path.empty () && path[0] == '/')
+    {
+      return path;
+    }
+  char cwd[4096];
+  if (getcwd (cwd, sizeof (cwd)) == 0)
+    {
+      NS_FATAL_ERROR ("getcwd failed: " << std::strerror (errno));
+    }
+  return std::string (cwd) + "/" + path;
+}
+
+void
+MakeDirectory (const std::string &path)
+{
+  if (mkdir (path.c_str (), 0755) != 0 && errno != EEXIST)
+    {
+      NS_FATAL_ERROR ("Can't create directory " << path << ": " << std::strerror (errno));
+    }
+}
+
+pid_t
+StartRun (const SweepRun &run, const std::vector<SweepAxis> &axes,
+          const std::string &program, const std::vector<std::string> &extraArgs, uint32_t timeout)
+{
+  std::vector<std::string> args;
+  args.push_back (program);
+  for (uint32_t i = 0; i < axes.size (); i++)
+    {
+      args.push_back ("--" + axes[i].name + "=" + run.values[i]);
+    }
+  args.insert (args.end (), extraArgs.begin (), extraArgs.end ());
+  return StartIsolatedRun (run.dir, args, timeout);
+}
+
+// Concatenate 'filename' of every successful run into a single table.
+// The header of the first file found is kept, with the sweep columns
+// prepended; header lines ('%' or '#') of all the other files are dropped.
+void
+MergeTraces (const std::string &filename, const std::vector<SweepRun> &runs,
+             const std::vector<SweepAxis> &axes, const std::string &outDir)
+{
+  std::string outName = outDir + "/" + filename;
+  std::ofstream outFile (outName.c_str (), std::ios_base::out | std::ios_base::trunc);
+  if (!outFile.is_open ())
+    {
+      NS_LOG_ERROR ("Can't open file " << outName);
+      return;
+    }
+
+  bool headerWritten = false;
+  uint64_t nRows = 0;
+  for (uint32_t r = 0; r < runs.size (); r++)
+    {
+      const SweepRun &run = runs[r];
+      if (!WIFEXITED (run.status) || WEXITSTATUS (run.status) != 0)
+        {
+          continue;
+        }
+      std::string inName = run.dir + "/" + filename;
+      std::ifstream inFile (inName.c_str ());
+      if (!inFile.is_open ())
+        {
+          NS_LOG_WARN ("Run " << run.id << " did not produce " << filename);
+          continue;
+        }
+
+      std::ostringstream prefix;
+      prefix << run.id;
+      for (uint32_t i = 0; i < axes.size (); i++)
+        {
+          prefix << '\t' << run.values[i];
+        }
+      prefix << '\t';
+
+      std::string line;
+      while (std::getline (inFile, line))
+        {
+          if (line.empty ())
+            {
+              continue;
+            }
+          if (line[0] == '%' || line[0] == '#')
+            {
+              if (!headerWritten)
+                {
+                  std::string::size_type start = line.find_first_not_of ("%# ");
+                  outFile << "% run";
+                  for (uint32_t i = 0; i < axes.size (); i++)
+                    {
+                      outFile << '\t' << axes[i].name;
+                    }
+                  outFile << '\t' << (start == std::string::npos ? "" : line.substr (start)) << '\n';
+                  headerWritten = true;
+                }
+              continue;
+            }
+          outFile << prefix.str () << line << '\n';
+          nRows++;
+        }
+    }
+  outFile.close ();
+  std::cout << "Merged " << nRows << " rows into " << outName << std::endl;
+}
+
+} // anonymous namespace
+
+int
+main (int argc, char *argv[])
+{
+  // Sweep axes, each a comma separated list of values; empty ones are left at
+  // the LteWatson defaults
+  std::string nUes = "";
+  std::string ray = "";
+  std::string environment = "";
+  std::string citySize = "";
+  std::string fading = "";
+  std::string stream = "";
+  std::string simTime = "";
+
+  std::string program = DefaultProgramPath (argv[0]);
+  std::string outDir = "sweep";
+  std::string extraArgs = "";
+  std::string merge = "DlRsrpSinrStats.txt,DlRlcStats.txt";
+  uint32_t jobs = sysconf (_SC_NPROCESSORS_ONLN);
+  bool fastExit = true;
+  uint32_t timeout = 0;
+
+  CommandLine cmd;
+  cmd.AddValue ("nUes", "Comma separated values of LteWatson --nUes", nUes);
+  cmd.AddValue ("ray", "Comma separated values of LteWatson --ray", ray);
+  cmd.AddValue ("environment", "Comma separated values of LteWatson --environment", environment);
+  cmd.AddValue ("citySize", "Comma separated values of LteWatson --citySize", citySize);
+  cmd.AddValue ("fading", "Comma separated values of LteWatson --fading", fading);
+  cmd.AddValue ("stream", "Comma separated values of LteWatson --stream", stream);
+  cmd.AddValue ("simTime", "Comma separated values of LteWatson --simTime", simTime);
+  cmd.AddValue ("program", "Path of the LteWatson executable", program);
+  cmd.AddValue ("outDir", "Directory holding one sub-directory per run and the merged tables", outDir);
+  cmd.AddValue ("extraArgs", "Space separated arguments passed unchanged to every run", extraArgs);
+  cmd.AddValue ("merge", "Comma separated trace files to merge across runs", merge);
+  cmd.AddValue ("jobs", "Maximum number of concurrent runs [Default=number of cores]", jobs);
+  cmd.AddValue ("fastExit", "Run with --fastExit=1, skipping the teardown of each run [Default=1]", fastExit);
+  cmd.AddValue ("timeout", "Wall seconds after which a run is stopped, 0 for no limit", timeout);
+  cmd.Parse (argc, argv);
+
+  if (jobs == 0)
+    {
+      jobs = 1;
+    }
+  program = AbsolutePath (program);
+  if (access (program.c_str (), X_OK) != 0)
+    {
+      NS_FATAL_ERROR ("Can't execute " << program << ", use --program to point at LteWatson");
+    }
+
+  std::vector<SweepAxis> axes;
+  const char *axisNames[] = { "nUes", "ray", "environment", "citySize", "fading", "stream", "simTime" };
+  const std::string *axisValues[] = { &nUes, &ray, &environment, &citySize, &fading, &stream, &simTime };
+  for (uint32_t i = 0; i < sizeof (axisNames) / sizeof (axisNames[0]); i++)
+    {
+      std::vector<std::string> values = SplitString (*axisValues[i], ',');
+      if (!values.empty ())
+        {
+          SweepAxis axis;
+          axis.name = axisNames[i];
+          axis.values = values;
+          axes.push_back (axis);
+        }
+    }
+
+  // Expand the grid, last axis varying fastest
+  uint32_t nRuns = 1;
+  for (uint32_t i = 0; i < axes.size (); i++)
+    {
+      nRuns *= axes[i].values.size ();
+    }
+
+  MakeDirectory (outDir);
+  outDir = AbsolutePath (outDir);
+  std::vector<SweepRun> runs (nRuns);
+  for (uint32_t r = 0; r < nRuns; r++)
+    {
+      SweepRun &run = runs[r];
+      run.id = r;
+      run.values.resize (axes.size ());
+      uint32_t rem = r;
+      for (int32_t i = axes.size () - 1; i >= 0; i--)
+        {
+          run.values[i] = axes[i].values[rem % axes[i].values.size ()];
+          rem /= axes[i].values.size ();
+        }
+      std::ostringstream dir;
+      dir << outDir << "/run-" << std::setw (4) << std::setfill ('0') << r;
+      run.dir = dir.str ();
+      run.pid = -1;
+      run.status = -1;
+      run.startTime = 0;
+      run.wallTime = 0;
+      MakeDirectory (run.dir);
+    }
+
+  std::vector<std::string> extra = SplitString (extraArgs, ' ');
+  if (fastExit)
+    {
+      extra.push_back ("--fastExit=1");
+    }
+
+  std::cout << "Sweeping " << nRuns << " points of " << program
+            << " with " << jobs << " concurrent jobs" << std::endl;
+
+  // Simple process pool: keep 'jobs' children alive until the grid is exhausted
+  uint32_t nextRun = 0;
+  uint32_t nRunning = 0;
+  uint32_t nDone = 0;
+  uint32_t nFailed = 0;
+  double sweepStart = WallClockSeconds ();
+  while (nDone < nRuns)
+    {
+      while (nRunning < jobs && nextRun < nRuns)
+        {
+          SweepRun &run = runs[nextRun++];
+          run.startTime = WallClockSeconds ();
+          run.pid = StartRun (run, axes, program, extra, timeout);
+          nRunning++;
+        }
+
+      int status;
+      pid_t pid = waitpid (-1, &status, 0);
+      if (pid < 0)
+        {
+          if (errno == EINTR)
+            {
+              continue;
+            }
+          NS_FATAL_ERROR ("waitpid failed: " << std::strerror (errno));
+        }
+      for (uint32_t r = 0; r < nextRun; r++)
+        {
+          if (runs[r].pid == pid)
+            {
+              runs[r].status = status;
+              runs[r].wallTime = WallClockSeconds () - runs[r].startTime;
+              runs[r].pid = -1;
+              nRunning--;
+              nDone++;
+              bool ok = WIFEXITED (status) && WEXITSTATUS (status) == 0;
+              if (!ok)
+                {
+                  nFailed++;
+                }
+              bool timedOut = WIFSIGNALED (status) && WTERMSIG (status) == SIGALRM;
+              std::cout << "\r[" << nDone << "/" << nRuns << "] run " << r
+                        << (ok ? " done in " : timedOut ? " TIMED OUT after " : " FAILED after ")
+                        << runs[r].wallTime << " s   " << std::flush;
+              break;
+            }
+        }
+    }
+  std::cout << std::endl << "Sweep finished in " << WallClockSeconds () - sweepStart
+            << " s, " << nFailed << " failed run(s)" << std::endl;
+
+  // Index of all the runs, so failed points can be found and re-run
+  std::string indexName = outDir + "/runs.txt";
+  std::ofstream indexFile (indexName.c_str (), std::ios_base::out | std::ios_base::trunc);
+  indexFile << "% run";
+  for (uint32_t i = 0; i < axes.size (); i++)
+    {
+      indexFile << '\t' << axes[i].name;
+    }
+  indexFile << "\texitStatus\twallTime\tdir\n";
+  for (uint32_t r = 0; r < nRuns; r++)
+    {
+      indexFile << r;
+      for (uint32_t i = 0; i < axes.size (); i++)
+        {
+          indexFile << '\t' << runs[r].values[i];
+        }
+      int exitStatus = WIFEXITED (runs[r].status) ? WEXITSTATUS (runs[r].status) : -1;
+      indexFile << '\t' << exitStatus << '\t' << runs[r].wallTime << '\t' << runs[r].dir << '\n';
+    }
+  indexFile.close ();
+
+  std::vector<std::string> mergeFiles = SplitString (merge, ',');
+  for (uint32_t i = 0; i < mergeFiles.size (); i++)
+    {
+      MergeTraces (mergeFiles[i], runs, axes, outDir);
+    }
+
+  return nFailed == 0 ? 0 : 1;
+}
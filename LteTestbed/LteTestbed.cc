@@ -1,24 +1,103 @@
 // LTE Testbed for multiple cell simulation
 
+/*
+Run Commands:
+1.  ./waf --run scratch/LteTestbed/LteTestbed --cwd scratch/LteTestbed/
+
+2.  ./waf --run "scratch/LteTestbed/LteTestbed --topology=topology-57cell.cfg --simTime=10" --cwd scratch/LteTestbed/
+
+The layout (sites, sectors, users per cell) comes from the topology file, see
+common/hex-grid-topology.h. The default is the 57 cell (19 sites x 3 sectors)
+hex grid.
+*/
+
 #include "ns3/core-module.h"
 #include "ns3/network-module.h"
 #include "ns3/mobility-module.h"
 #include "ns3/lte-module.h"
 
+#include "../common/hex-grid-topology.h"
+#include "../common/event-profiler.h"
+#include "../common/fast-exit.h"
+#include "../common/phase-timer.h"
+#include "../common/scenario-builder.h"
+#include "../common/scheduler-type.h"
+
 using namespace ns3;
 
+NS_LOG_COMPONENT_DEFINE( "LteTestbed" );
+
 int main( int argc, char *argv[] ) {
 
     // Configuration
-    // double cellRadius = 1500.00;
+    std::string topologyFile = "topology-57cell.cfg";
+    double simTime = 5.00;
+    bool fastExit = false;
+    bool profileEvents = false;
+    std::string scheduler = "";
+
+    CommandLine cmd;
+    cmd.AddValue( "topology", "Cell layout and users per cell", topologyFile );
+    cmd.AddValue( "simTime", "Simulation duration in seconds", simTime );
+    cmd.AddValue( "fastExit", "Flush the traces and exit without tearing down the simulation", fastExit );
+    cmd.AddValue( "profileEvents", "Count and time the events by target, ranked in EventProfile.txt", profileEvents );
+    cmd.AddValue( "scheduler", "Event queue: map, heap, list or calendar [Default: ns-3 SchedulerType]", scheduler );
+    cmd.Parse( argc, argv );
+    FastExit::Enable( fastExit );
+    SelectScheduler( scheduler );
+    EventProfiler::Enable( profileEvents );
+
+    HexGridTopologyConfig topologyConfig;
+    topologyConfig.Load( topologyFile );
+    HexGridTopologyBuilder topology( topologyConfig );
+
+    // Radio only, no EPC
+    LteScenarioBuilder scenario( LteScenarioBuilder::NO_EPC );
+
+    // Nodes and mobility for every cell
+    PhaseTimer::Get().Begin( "nodes" );
+    topology.CreateNodes();
+    PhaseTimer::Get().End();
+    NS_LOG_INFO( topologyConfig.GetNSites() << " sites x " << topologyConfig.sectors << " sectors = "
+                 << topology.GetNCells() << " cells, " << topology.GetUeNodes().GetN() << " users, ISD "
+                 << topologyConfig.GetInterSiteDistance() << " m" );
+
+    // Setup LTE network
+    Ptr<LteHelper> lteHelper    = scenario.GetLteHelper();
+    lteHelper->SetAttribute( "PathlossModel", StringValue("ns3::OkumuraHataPropagationLossModel") );
+    lteHelper->SetPathlossModelAttribute( "Environment", StringValue("Urban") );
+    PhaseTimer::Get().Begin( "lte-devices" );
+    topology.InstallDevices( lteHelper );
+    PhaseTimer::Get().End();
+    PhaseTimer::Get().Begin( "attach" );
+    topology.Attach( lteHelper );
+    PhaseTimer::Get().End();
+
+    // Activate saturation traffic
+    enum EpsBearer::Qci q = EpsBearer::GBR_CONV_VOICE;
+    EpsBearer bearer( q );
+    lteHelper->ActivateDataRadioBearer( topology.GetUeDevices(), bearer );
+
+    // Enable Logging
+    lteHelper->EnableTraces();
+    FastExit::AddLteStats( lteHelper );
+
+    Simulator::Stop( Seconds(simTime) );
 
-    // number of users
-    // @TODO
+    PhaseTimer::Get().Begin( "run" );
+    Simulator::Run();
+    PhaseTimer::Get().End();
+    EventProfiler::Report( "EventProfile.txt" );    // only with --profileEvents
 
-    Ptr<LteHelper> lteHelper    = CreateObject<LteHelper>();
+    PhaseTimer::Get().Begin( "destroy" );
+    FastExit::Destroy();    // only flushes with --fastExit
+    PhaseTimer::Get().End();
 
-    Ptr<LteHexGridEnbTopologyHelper> cellTopology = CreateObject<LteHexGridEnbTopologyHelper>();
+    // Wall time and peak memory of each phase
+    PhaseTimer::Get().Print( std::cout );
+    PhaseTimer::Get().WriteJson( "PhaseTimes.json" );
 
+    FastExit::Exit( 0 );    // no teardown with --fastExit
 
     return 0;
 }
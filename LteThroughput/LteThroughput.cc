@@ -10,10 +10,19 @@
 #include "ns3/applications-module.h"
 #include "ns3/internet-module.h"
 
+#include "../common/event-profiler.h"
+#include "../common/fast-exit.h"
+#include "../common/flow-counters.h"
+#include "../common/phase-timer.h"
+#include "../common/scenario-builder.h"
+
 #include "ns3/gnuplot.h"
 #include "ns3/flow-monitor-module.h"
 #include <ns3/flow-monitor-helper.h>
 
+#include "../common/scheduler-type.h"
+#include "../common/throughput-sampler.h"
+
 
 using namespace ns3;
 
@@ -22,62 +31,7 @@ NS_LOG_COMPONENT_DEFINE( "LteTrafficVoIP" );
 // Definitions for Mobility Tracking -- comment to disable trace
 //#define ENABLE_MOBILITY_TRACKING
 
-void ThroughputMonitor (FlowMonitorHelper *fmhelper, Ptr<FlowMonitor> flowMon,Gnuplot2dDataset DataSet) {
-    static double localThrou;
-    static unsigned lastRxBytes;
-    static Time timeLastRxPacket;
-    std::map<FlowId, FlowMonitor::FlowStats> flowStats = flowMon->GetFlowStats();
-    Ptr<Ipv4FlowClassifier> classing = DynamicCast<Ipv4FlowClassifier> (fmhelper->GetClassifier());
-    for (std::map<FlowId, FlowMonitor::FlowStats>::const_iterator stats = flowStats.begin (); stats != flowStats.end (); ++stats) {
-        Ipv4FlowClassifier::FiveTuple fiveTuple = classing->FindFlow (stats->first);
-        if( fiveTuple.destinationAddress == "1.0.0.2" ) {
-            if( stats->second.timeLastRxPacket != timeLastRxPacket ) {
-                localThrou = (stats->second.rxBytes-lastRxBytes)*8.0 /(stats->second.timeLastRxPacket.GetSeconds()-timeLastRxPacket.GetSeconds())/1024/1024;
-            } else {
-                localThrou = 0.00;
-            }
-            std::cout << "Last Rx Bytes       : " << lastRxBytes << std::endl
-                      << "Last Rx Packet Time : " << timeLastRxPacket.GetSeconds() << " sec" << std::endl
-                      << "Curr Rx Bytes       : " << stats->second.rxBytes << std::endl
-                      << "Curr Rx Packet Time : " << stats->second.timeLastRxPacket.GetSeconds() << " sec" << std::endl
-                      << "Throughput          : " << localThrou << " Mbps" << std::endl;
-            std::cout << "---------------------------------------------------------------------------" << std::endl;
-            timeLastRxPacket = stats->second.timeLastRxPacket;
-            lastRxBytes = stats->second.rxBytes;
-            DataSet.Add((double)Simulator::Now().GetSeconds(),(double) localThrou);
-        }
-    }
-    Simulator::Schedule(Seconds(0.25),&ThroughputMonitor, fmhelper, flowMon,DataSet);
-    //if(flowToXml)
-    {
-        flowMon->SerializeToXmlFile ("ThroughputMonitor.xml", true, true);
-    }
-
-}
-
-
-#ifdef ENABLE_MOBILITY_TRACKING
-static void CourseChange (std::string traceStr, Ptr<const MobilityModel> mobility) {
-  Vector pos = mobility->GetPosition ();
-  Vector vel = mobility->GetVelocity ();
-  std::cout << Simulator::Now ()
-            << " Trace:" << traceStr << "    "
-            << " POS: (" << pos.x << "," << pos.y << "," << pos.z << ")"
-            << " VEL: (" << vel.x << "," << vel.y << "," << vel.z << ")" << std::endl;
-}
-
-static void ReportPosition( Ptr<Node> thisNode ) {
-    Vector pos = thisNode->GetObject<MobilityModel>()->GetPosition();
-    Vector vel = thisNode->GetObject<MobilityModel>()->GetVelocity();
-    std::cout << Simulator::Now()
-              << " Node#" << thisNode->GetId()
-              << " POS: (" << pos.x << "," << pos.y << "," << pos.z << ")"
-              << " VEL: (" << vel.x << "," << vel.y << "," << vel.z << ")"
-              << std::endl;
-}
-#endif
-
-int main(int argc, char const *argv[]) {
+int main(int argc, char *argv[]) {
 
     double enbX = 0.00, enbY = 0.00, enbZ = 30.00;  // Base Station Position in canvas
     double ueMaxRadius  = 1000.00;  // Radius around eNodeB for users to allocate positions and waypoints
@@ -85,9 +39,27 @@ int main(int argc, char const *argv[]) {
     uint32_t noOfUeNodes = 2;
     uint32_t simDuration = 20;  // In Seconds
 
+    // Command line
+    bool fastExit = false;
+    bool profileEvents = false;
+    std::string scheduler = "";
+    bool flowMonitor = false;
+    uint32_t delaySampling = 0;
+    CommandLine cmd;
+    cmd.AddValue( "fastExit", "Flush the traces and exit without tearing down the simulation", fastExit );
+    cmd.AddValue( "profileEvents", "Count and time the events by target, ranked in EventProfile.txt", profileEvents );
+    cmd.AddValue( "scheduler", "Event queue: map, heap, list or calendar [Default: ns-3 SchedulerType]", scheduler );
+    cmd.AddValue( "flowMonitor", "Full FlowMonitor on every node instead of the endpoint FlowCounters", flowMonitor );
+    cmd.AddValue( "delaySampling", "FlowCounters: sample the delay of one packet in that many per flow, 0 for none", delaySampling );
+    cmd.Parse( argc, argv );
+    FastExit::Enable( fastExit );
+    SelectScheduler( scheduler );
+    EventProfiler::Enable( profileEvents );
+
     // Setup time resolution
     Time::SetResolution( Time::NS );
 
+    PhaseTimer::Get().Begin( "nodes" );
     // Create eNodeBs
     NS_LOG_INFO( "Creating eNodeB nodes..." );
     NodeContainer eNodeBs;  eNodeBs.Create(1);
@@ -98,7 +70,10 @@ int main(int argc, char const *argv[]) {
     NS_LOG_INFO( "Creating a single remote node..." );
     NodeContainer remoteNode;   remoteNode.Create(1);
 
+    PhaseTimer::Get().End();
+
     // ####################   SETUP MOBILTY MODELS FOR SIMUALTION ##############
+    PhaseTimer::Get().Begin( "mobility" );
 
 
     NS_LOG_INFO( "Setting up mobility model..." );
@@ -129,23 +104,17 @@ int main(int argc, char const *argv[]) {
     ueMobility.Install( ueNodes );
 
 #ifdef ENABLE_MOBILITY_TRACKING
-    // Enable tracing the UE positions
-    Config::Connect( "/NodeList/*/$ns3::MobilityModel/CourseChange", MakeCallback (&CourseChange) );
-    // Create events every second to report back the current position of UEs
-    for( uint32_t ueIdx = 0; ueIdx < 2; ueIdx ++ ) {
-        for( uint32_t stepIdx = 0; stepIdx < simDuration; stepIdx++ ) {
-            Simulator::Schedule( Time(Seconds(stepIdx)), ReportPosition, ueNodes.Get(ueIdx) );
-        }
-    }
+    // Print course changes and the positions of the UEs every second
+    EnableMobilityTracking( ueNodes );
 #endif
+    PhaseTimer::Get().End();
     // ######################## END OF MOBILITY SETUP ##########################
 
     // ########################## LTE NETWORK SETUP ############################
-    // Create an Lte Helper
-    Ptr<LteHelper> lteHelper    = CreateObject<LteHelper>();
-    Ptr<PointToPointEpcHelper> epcHelper    = CreateObject<PointToPointEpcHelper>();
-    lteHelper->SetEpcHelper( epcHelper );   // Install EPC Helper to LTE
-    Ptr<Node> pgwNode   = epcHelper->GetPgwNode();
+    // Create an Lte Helper with its EPC
+    LteScenarioBuilder scenario;
+    Ptr<LteHelper> lteHelper    = scenario.GetLteHelper();
+    Ptr<Node> pgwNode   = scenario.GetPgwNode();
 
     lteHelper->SetFadingModel("ns3::TraceFadingLossModel");
     lteHelper->SetFadingModelAttribute ("TraceFilename", StringValue ("../../src/lte/model/fading-traces/fading_trace_ETU_3kmph.fad"));
@@ -154,51 +123,23 @@ int main(int argc, char const *argv[]) {
     lteHelper->SetFadingModelAttribute ("WindowSize", TimeValue (Seconds (0.5)));
     lteHelper->SetFadingModelAttribute ("RbNum", UintegerValue (100));
 
-    // Set up remote node for internet access
-    InternetStackHelper inetHelper; inetHelper.Install( remoteNode );
-
-    // Create a Point To Point link between ENB's PGW and remote node
-    PointToPointHelper p2pHelper;
-    p2pHelper.SetDeviceAttribute( "DataRate", DataRateValue(DataRate("100Gb/s")) );
-    p2pHelper.SetDeviceAttribute( "Mtu", UintegerValue(1500) );
-    p2pHelper.SetChannelAttribute( "Delay", TimeValue(Seconds(0.010)) );
-    NetDeviceContainer inetDev = p2pHelper.Install( pgwNode, remoteNode.Get(0) );
-
-    // Assign IP addresses
-    Ipv4AddressHelper ipv4Helper;
-    ipv4Helper.SetBase( "1.0.0.0", "255.0.0.0" );
-    Ipv4InterfaceContainer ipv4interfaces = ipv4Helper.Assign( inetDev );
-
-    // State the routing
-    Ipv4StaticRoutingHelper ipv4RoutingHelper;
-    Ptr<Ipv4StaticRouting> remoteNodeStaticRouting = ipv4RoutingHelper.GetStaticRouting( remoteNode.Get(0)->GetObject<Ipv4>() );
-    remoteNodeStaticRouting->AddNetworkRouteTo( Ipv4Address("7.0.0.0"), Ipv4Mask("255.0.0.0"), 1 );
+    // Connect the remote node to the PGW (1.0.0.0/16) with a route to the UEs (7.0.0.0/8)
+    scenario.InstallRemoteHosts( remoteNode );
 
     // Install LTE Network device at eNodeBs
     NS_LOG_INFO( "Installing LTE network device at eNodeB" );
-    NetDeviceContainer enbDevs  = lteHelper->InstallEnbDevice( eNodeBs );
+    NetDeviceContainer enbDevs  = scenario.InstallEnbDevices( eNodeBs );
     // Install LTE Network device at ueNodes
     NS_LOG_INFO( "Installing LTE network device at UE" );
-    NetDeviceContainer ueDevs   = lteHelper->InstallUeDevice( ueNodes );
-
-    NS_LOG_INFO( "Installing Internet Stack on UEs..." );
-    // Install Internet Stack to UEs
-    inetHelper.Install( ueNodes );
-
-    // assign IP addresses to UEs and add apps
-    NS_LOG_INFO( "Assigning IP Addresses to UEs..." );
-    Ipv4InterfaceContainer ueIpInf = epcHelper->AssignUeIpv4Address( ueDevs );
-    for( uint32_t idx = 0; idx < ueNodes.GetN(); idx++ ) {
-        Ptr<Node> thisUe    = ueNodes.Get( idx );
-        Ptr<NetDevice> thisUeDev = ueDevs.Get( idx );
-        // Setup default gateway
-        Ptr<Ipv4StaticRouting>ueNodeStaticRouting = ipv4RoutingHelper.GetStaticRouting( thisUe->GetObject<Ipv4>() );
-        ueNodeStaticRouting->SetDefaultRoute( epcHelper->GetUeDefaultGatewayAddress(), 1 );
-    }
+    NetDeviceContainer ueDevs   = scenario.InstallUeDevices( ueNodes );
+
+    // Install Internet Stack, IP addresses and default routes on UEs
+    NS_LOG_INFO( "Setting up Internet on UEs..." );
+    scenario.InstallUeInternet( ueNodes, ueDevs );
 
     // Attach UEs to eNodeB
     NS_LOG_INFO( "Attaching UEs to eNodeB" );
-    lteHelper->Attach( ueDevs, enbDevs.Get(0) );
+    scenario.Attach( ueDevs, enbDevs.Get(0) );
 
     // Get IP address of all nodes
     std::cout << "IP v4 Addresses: " << std::endl
@@ -314,7 +255,6 @@ int main(int argc, char const *argv[]) {
     std::string graphicsFileName        = fileNameWithNoExtension + ".png";
     std::string plotFileName            = fileNameWithNoExtension + ".plt";
     std::string plotTitle               = "Flow vs Throughput";
-    std::string dataTitle               = "Throughput";
 
     // Instantiate the plot and set its title.
     Gnuplot gnuplot (graphicsFileName);
@@ -325,30 +265,39 @@ int main(int argc, char const *argv[]) {
     gnuplot.SetTerminal ("png");
 
     // Set the labels for each axis.
-    gnuplot.SetLegend ("Time", "Throughput");
-
-
-   Gnuplot2dDataset dataset;
-   dataset.SetTitle (dataTitle);
-   dataset.SetStyle (Gnuplot2dDataset::LINES_POINTS);
-
-  //flowMonitor declaration
-  FlowMonitorHelper fmHelper;
-  Ptr<FlowMonitor> allMon = fmHelper.InstallAll();
-  // call the flow monitor function
-  ThroughputMonitor(&fmHelper, allMon, dataset);
+    gnuplot.SetLegend ("Time", "Throughput (Mbps)");
+
+    // Flow statistics: counters at the UEs and the remote node, or the full flowMonitor
+    FlowCounters flowCounters( delaySampling );
+    FlowMonitorHelper fmHelper;
+    Ptr<FlowMonitor> allMon;
+    if( flowMonitor ) {
+        allMon = fmHelper.InstallAll();
+    } else {
+        flowCounters.Install( ueNodes );
+        flowCounters.Install( remoteNode );
+    }
+    // Throughput of every flow, sampled every 0.25 s
+    ThroughputSampler throughputSampler = flowMonitor
+        ? ThroughputSampler( allMon, DynamicCast<Ipv4FlowClassifier>( fmHelper.GetClassifier() ), Seconds(0.25) )
+        : ThroughputSampler( &flowCounters, Seconds(0.25) );
+    throughputSampler.Start();
 
 
     // Enable LTE Traces
     NS_LOG_INFO( "Enabling LTE Traces..." );
     lteHelper->EnableTraces();
+    FastExit::AddLteStats( lteHelper );
 
     Simulator::Stop( Seconds(simDuration) );
 
     NS_LOG_INFO( "Starting Simulator..." );
+    PhaseTimer::Get().Begin( "run" );
     Simulator::Run();
-    //Gnuplot ...continued
-    gnuplot.AddDataset (dataset);
+    PhaseTimer::Get().End();
+    EventProfiler::Report( "EventProfile.txt" );    // only with --profileEvents
+    //Gnuplot ...continued, one dataset per flow
+    throughputSampler.AddDatasets (gnuplot);
     // Open the plot file.
     std::ofstream plotFile (plotFileName.c_str());
     // Write the plot file.
@@ -356,10 +305,25 @@ int main(int argc, char const *argv[]) {
     // Close the plot file.
     plotFile.close ();
 
+    // Flow statistics, once at the end
+    if( flowMonitor ) {
+        allMon->SerializeToXmlFile( "ThroughputMonitor.xml", true, true );
+    } else {
+        flowCounters.SerializeToXmlFile( "ThroughputMonitor.xml" );
+    }
+
 
     NS_LOG_INFO( "Stoping Simulator..." );
 
-    Simulator::Destroy();
+    PhaseTimer::Get().Begin( "destroy" );
+    FastExit::Destroy();    // only flushes with --fastExit
+    PhaseTimer::Get().End();
+
+    // Wall time and peak memory of each phase
+    PhaseTimer::Get().Print( std::cout );
+    PhaseTimer::Get().WriteJson( "PhaseTimes.json" );
+
+    FastExit::Exit( 0 );    // no teardown with --fastExit
 
     return 0;
 }
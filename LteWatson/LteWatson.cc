@@ -46,21 +46,22 @@
 #include "src/core/model/log.h"
 #include "src/core/model/config.h"
 
+#include "../fading-traces/mmap-trace-fading-loss-model.h"
+#include "../common/cached-propagation-loss-model.h"
+#include "../common/dl-rsrp-sinr-columnar-sink.h"
+#include "../common/event-profiler.h"
+#include "../common/fast-exit.h"
+#include "../common/mobility-sampler.h"
+#include "../common/multi-flow-source.h"
+#include "../common/phase-timer.h"
+#include "../common/scenario-builder.h"
+#include "../common/scheduler-type.h"
+
 #define SAT 20000000
 #define NODE 10 //Node of nodelist
 #define APP 28 //App of node
 using namespace ns3;
 
-static uint32_t nodo=0;
-static std::ofstream outfile_pos;
-
-//function for tracing
-void CourseChange (Ptr<Node> node){
-    Vector position = node->GetObject<MobilityModel>()->GetPosition();
-    nodo = node->GetId();
-    outfile_pos<<(nodo - 2)<<'\t'<<Simulator::Now()<<' '<<position.x<<' '<<position.y<<' '<<position.z<<std::endl;
-}
-
 void ReportProgress( void ) {
     std::cout << "\r Simulation: " << Simulator::Now();
 }
@@ -76,8 +77,6 @@ int main(int argc, char** argv) {
   //LogComponentEnable ("FlowMonitor", LOG_LEVEL_ALL);
   #endif
 
-  outfile_pos.open("PositionTrace.txt");
-
   //Default Configuration
     uint32_t nUes=10; //number of interferent Ue's;
     uint32_t nEnbs = 1; //Single Cell
@@ -88,6 +87,13 @@ int main(int argc, char** argv) {
     double ray=1500;
 
     int64_t stream = -1;
+    bool columnarTraces = false;
+    bool fullBuffer = false;
+    bool fastExit = false;
+    bool profileEvents = false;
+    std::string scheduler = "";
+    bool cachePathloss = false;
+    std::string positionFormat = "csv";
 
     std::stringstream rate;//saturation Condition
     std::string traceFadingPath="";
@@ -106,18 +112,24 @@ int main(int argc, char** argv) {
     cmd.AddValue("environment","Ambiente di propagazione [Default=OpenAreas]",environment);
     cmd.AddValue("citySize","Larghezza della città [Default=Large]",citySize);
     cmd.AddValue("stream","Indice di Stream di numeri casuali",stream);
+    cmd.AddValue("positionFormat","Formato di PositionTrace: csv o bin [Default=csv]",positionFormat);
+    cmd.AddValue("columnarTraces","Scrivi DlRsrpSinrStats in formato colonnare binario (.ctr)[Default=0]",columnarTraces);
+    cmd.AddValue("fullBuffer","Buffer RLC sempre pieno (RLC SM) al posto del traffico dal remote host [Default=0]",fullBuffer);
+    cmd.AddValue("fastExit","Scrivi le tracce ed esci senza distruggere la simulazione [Default=0]",fastExit);
+    cmd.AddValue("profileEvents","Conta e misura gli eventi per tipo, tabella in EventProfile.txt [Default=0]",profileEvents);
+    cmd.AddValue("scheduler","Coda degli eventi: map, heap, list o calendar [Default=SchedulerType di ns-3]",scheduler);
+    cmd.AddValue("cachePathloss","Memorizza il pathloss tra nodi fermi [Default=0]",cachePathloss);
     cmd.Parse(argc, argv);
+    FastExit::Enable(fastExit);
+    SelectScheduler(scheduler);
+    EventProfiler::Enable(profileEvents);
 
     uint32_t totalNodes = nUes;
     rate<<(SAT/totalNodes)<<"b/s";
     //LTE Devices parameters
     NS_LOG_INFO("Lte-Epc helper creation");
-    Ptr<LteHelper> lteHelper = CreateObject<LteHelper> ();
-    Ptr<PointToPointEpcHelper> epcHelper    = CreateObject<PointToPointEpcHelper>();
-    lteHelper->SetEpcHelper(epcHelper);
-
-    NS_LOG_INFO("Pgw creation");
-    Ptr<Node> pgw = epcHelper->GetPgwNode ();
+    LteScenarioBuilder scenario;
+    Ptr<LteHelper> lteHelper = scenario.GetLteHelper ();
 
     Config::SetDefault ("ns3::LteEnbNetDevice::DlBandwidth", UintegerValue (25)); // 5 MHz channel
     Config::SetDefault ("ns3::LteEnbNetDevice::UlBandwidth", UintegerValue (25)); // 5 MHz channel
@@ -130,27 +142,31 @@ int main(int argc, char** argv) {
     lteHelper->SetEnbDeviceAttribute("UlEarfcn", UintegerValue(18100));
     lteHelper->SetAttribute("Scheduler",StringValue("ns3::RrFfMacScheduler"));
     //Config::SetDefault("ns3::RrFfMacScheduler::CqiTimerThreshold",UintegerValue(1));
-    Config::SetDefault ("ns3::LteEnbRrc::EpsBearerToRlcMapping", EnumValue (LteEnbRrc::RLC_UM_ALWAYS));
+    // Full buffer: RLC SM riporta sempre un buffer pieno allo scheduler MAC
+    // e genera da sé le PDU, niente pacchetti dal remote host
+    Config::SetDefault ("ns3::LteEnbRrc::EpsBearerToRlcMapping",
+                        EnumValue (fullBuffer ? LteEnbRrc::RLC_SM_ALWAYS : LteEnbRrc::RLC_UM_ALWAYS));
     Config::SetDefault("ns3::LteSpectrumPhy::CtrlErrorModelEnabled",BooleanValue(false));
     Config::SetDefault("ns3::LteRlcUm::MaxTxBufferSize", UintegerValue(4294967295));
 
     //Propagation Model Configuration
     NS_LOG_INFO("Propagation model settings");
 
-    lteHelper->SetAttribute("PathlossModel",StringValue("ns3::OkumuraHataPropagationLossModel"));
+    // Attributi come default: con --cachePathloss il modello sta dietro la cache
+    SetPathlossModel (lteHelper, "ns3::OkumuraHataPropagationLossModel", cachePathloss);
 
     if(!environment.empty()){
-        lteHelper->SetPathlossModelAttribute("Environment", StringValue(environment));
+        Config::SetDefault("ns3::OkumuraHataPropagationLossModel::Environment", StringValue(environment));
         NS_LOG_INFO("Environment "<<environment);
     }
 
     else{
-        lteHelper->SetPathlossModelAttribute("Environment", StringValue("Urban"));
+        Config::SetDefault("ns3::OkumuraHataPropagationLossModel::Environment", StringValue("Urban"));
         NS_LOG_INFO("Default environment");
     }
 
     if(!citySize.empty())
-        lteHelper->SetPathlossModelAttribute("CitySize", StringValue(citySize));
+        Config::SetDefault("ns3::OkumuraHataPropagationLossModel::CitySize", StringValue(citySize));
 
 
     if (epochDuration > 0)
@@ -162,65 +178,44 @@ int main(int argc, char** argv) {
     NS_LOG_INFO("Fading model settings");
     if (fading)
     {
-        lteHelper->SetFadingModel("ns3::TraceFadingLossModel");
         if(!traceFadingPath.empty())
         {
             std::stringstream track_fad;
-            track_fad<<"src/lte/model/fading-traces/"<<traceFadingPath;
-            lteHelper->SetFadingModelAttribute ("TraceFilename", StringValue (track_fad.str()));
+            if(traceFadingPath[0]!='/')     // absolute paths are used as is (e.g. runs started by LteSweep)
+                track_fad<<"src/lte/model/fading-traces/";
+            track_fad<<traceFadingPath;
+            SetTraceFadingModel (lteHelper, track_fad.str());
             NS_LOG_INFO("FadingTrace: "<<track_fad.str());
 
         }
         else
         {
-            lteHelper->SetFadingModelAttribute ("TraceFilename", StringValue ("/Users/vish/developer/ns3/bake/source/ns-3-dev/scratch/LteWatson/fading-traces/fading_trace_EVA_60kmph.fad"));
+            SetTraceFadingModel (lteHelper, "/Users/vish/developer/ns3/bake/source/ns-3-dev/scratch/LteWatson/fading-traces/fading_trace_EVA_60kmph.fad");
             NS_LOG_INFO("Default fading trace EVA 60kmph");
         }
-
-    lteHelper->SetFadingModelAttribute ("TraceLength", TimeValue (Seconds (10.0)));
-    lteHelper->SetFadingModelAttribute ("SamplesNum", UintegerValue (10000));
-    lteHelper->SetFadingModelAttribute ("WindowSize", TimeValue (Seconds (0.5)));
-    lteHelper->SetFadingModelAttribute ("RbNum", UintegerValue (100));
     }
 
 
-    // Create a single RemoteHost
+    // Create a single RemoteHost, linked to the PGW with a route to the UEs
     NS_LOG_INFO("Remote Host creation");
-    NodeContainer remoteHostContainer;
-    remoteHostContainer.Create (1);
+    scenario.GetBackhaul ().SetChannelAttribute ("Delay", TimeValue (Seconds (0.0)));
+    scenario.GetBackhaul ().SetQueue ("ns3::DropTailQueue","MaxPackets", StringValue ("4294967295"));
+    NodeContainer remoteHostContainer = scenario.CreateRemoteHosts (1);
     Ptr<Node> remoteHost = remoteHostContainer.Get (0);
-    InternetStackHelper internet;
-    internet.Install (remoteHostContainer);
-
-    // Create the Internet
-    NS_LOG_INFO("P2P instauration");
-    PointToPointHelper p2ph;
-    p2ph.SetDeviceAttribute ("DataRate", DataRateValue (DataRate ("100Gb/s")));
-    p2ph.SetDeviceAttribute ("Mtu", UintegerValue (1500));
-    p2ph.SetChannelAttribute ("Delay", TimeValue (Seconds (0.0)));
-    p2ph.SetQueue("ns3::DropTailQueue","MaxPackets", StringValue ("4294967295"));
-    NetDeviceContainer internetDevices = p2ph.Install (pgw, remoteHost);
-    Ipv4AddressHelper ipv4h;
-    ipv4h.SetBase ("1.0.0.0", "255.0.0.0");
-    Ipv4InterfaceContainer internetIpIfaces = ipv4h.Assign (internetDevices);
-    // interface 0 is localhost, 1 is the p2p device
-  //  Ipv4Address remoteHostAddr = internetIpIfaces.GetAddress (1);
-
-    //Instradamento verso la rete di default LTE
-    Ipv4StaticRoutingHelper ipv4RoutingHelper;
-    Ptr<Ipv4StaticRouting> remoteHostStaticRouting = ipv4RoutingHelper.GetStaticRouting (remoteHost->GetObject<Ipv4> ());
-    remoteHostStaticRouting->AddNetworkRouteTo (Ipv4Address ("7.0.0.0"), Ipv4Mask ("255.0.0.0"), 1);
 
     NS_LOG_INFO("Lte Node Creation and positionation");
 
+    PhaseTimer::Get ().Begin ("nodes");
     NodeContainer enbNodes;
     enbNodes.Create(1);
     NodeContainer ueNodes;
     ueNodes.Create(totalNodes);
+    PhaseTimer::Get ().End ();
 
     double x=1500.0;
     double y=1500.0;
 
+    PhaseTimer::Get ().Begin ("mobility");
     MobilityHelper mobilityEnb;
     Ptr<ListPositionAllocator> positionAllocEnb = CreateObject<ListPositionAllocator> ();
     positionAllocEnb->Add(Vector(x,y,30));
@@ -251,6 +246,7 @@ int main(int argc, char** argv) {
            "PositionAllocator",PointerValue(allocWaypoint));
    mobilityUe.SetPositionAllocator(allocUe);
    mobilityUe.Install(ueNodes);
+    PhaseTimer::Get ().End ();
    //----------------
    // Ptr<UniformRandomVariable> wpRadiusSampler  = CreateObject<UniformRandomVariable>();
    // wpRadiusSampler->SetAttribute( "Max", DoubleValue(0.866*cellRadius) );   // maximum radius within cell boundary
@@ -272,35 +268,23 @@ int main(int argc, char** argv) {
    //----------------
 
 
-   NetDeviceContainer enbDevs;
-   NetDeviceContainer ueDevs;
-
-   enbDevs = lteHelper->InstallEnbDevice (enbNodes);
-   ueDevs = lteHelper->InstallUeDevice (ueNodes);
-
+   NetDeviceContainer enbDevs = scenario.InstallEnbDevices (enbNodes);
+   NetDeviceContainer ueDevs = scenario.InstallUeDevices (ueNodes);
 
-   //Installazione di Internet e assegnazion indirizzi di default
-    internet.Install(ueNodes);
-    Ipv4InterfaceContainer ueIpIfaces;
-    ueIpIfaces = epcHelper->AssignUeIpv4Address(NetDeviceContainer(ueDevs));
-
-    for (uint32_t u = 0; u < ueNodes.GetN (); ++u)
+    //Stream fissi per PHY/MAC e fading: LteHelper::AssignStreams non vede MmapTraceFadingLossModel
+    if (stream >= 0)
     {
-      Ptr<Node> ueNode = ueNodes.Get (u);
-      // Set the default gateway for the UE
-      Ptr<Ipv4StaticRouting> ueStaticRouting = ipv4RoutingHelper.GetStaticRouting (ueNode->GetObject<Ipv4> ());
-      ueStaticRouting->SetDefaultRoute (epcHelper->GetUeDefaultGatewayAddress (), 1);
+        int64_t nextStream = stream + lteHelper->AssignStreams (enbDevs, stream);
+        nextStream += lteHelper->AssignStreams (ueDevs, nextStream);
+        MmapTraceFadingLossModel::AssignStreamsToInstances (nextStream);
     }
 
-    //necessario per i nodi sonda
-
-    //Attacchiamo il nodo mobile alla stazione base
-    for (uint32_t i = 0; i < ueDevs.GetN(); i++)
-      {
-        lteHelper->Attach (ueDevs.Get(i), enbDevs.Get(0));
+    //Installazione di Internet, indirizzi e route di default in blocco
+    Ipv4InterfaceContainer ueIpIfaces = scenario.InstallUeInternet (ueNodes, ueDevs);
 
-        // side effect: the default EPS bearer will be activated
-      }
+    //Attacchiamo i nodi mobili alla stazione base
+    // side effect: the default EPS bearer will be activated
+    scenario.Attach (ueDevs, enbDevs.Get (0));
 
 
     uint16_t dlPort = 1234;
@@ -308,24 +292,36 @@ int main(int argc, char** argv) {
     ApplicationContainer centralClientApps;
     ApplicationContainer centralServerApps;
     NS_LOG_INFO("Application Creation");
-    for (uint32_t u = 0; u < ueNodes.GetN (); ++u)
+    if (!fullBuffer)    // con RLC SM le PDU non arrivano dal remote host
     {
-        OnOffHelper onoff ("ns3::UdpSocketFactory", InetSocketAddress(ueIpIfaces.GetAddress(u), dlPort));
-        onoff.SetAttribute("OnTime",
-            StringValue("ns3::ConstantRandomVariable[Constant=1000]"));
-        onoff.SetAttribute("OffTime",
-            StringValue("ns3::ConstantRandomVariable[Constant=0]"));
-        onoff.SetAttribute("PacketSize",
-            UintegerValue(1024));
-        onoff.SetAttribute("DataRate",
-            StringValue(rate.str()));
-        centralClientApps.Add(onoff.Install(remoteHost));
-
-        PacketSinkHelper sink ("ns3::UdpSocketFactory",InetSocketAddress(Ipv4Address::GetAny(), dlPort));
-        centralServerApps.Add (sink.Install(ueNodes.Get(u)));
+        // Un'unica sorgente sul remote host per tutti i flussi, sempre accesi
+        Ptr<MultiFlowSource> source = CreateObject<MultiFlowSource> ();
+        remoteHost->AddApplication (source);
+        centralClientApps.Add (source);
+        for (uint32_t u = 0; u < ueNodes.GetN (); ++u)
+        {
+            source->AddFlow (InetSocketAddress(ueIpIfaces.GetAddress(u), dlPort), DataRate(rate.str()), 1024);
+
+            PacketSinkHelper sink ("ns3::UdpSocketFactory",InetSocketAddress(Ipv4Address::GetAny(), dlPort));
+            centralServerApps.Add (sink.Install(ueNodes.Get(u)));
+        }
     }
 
-   lteHelper->EnableTraces ();
+   DlRsrpSinrColumnarSink dlRsrpSinrStats;
+   if (columnarTraces)
+     {
+       if (!dlRsrpSinrStats.Open ("DlRsrpSinrStats.ctr"))
+         {
+           NS_FATAL_ERROR ("Can't create DlRsrpSinrStats.ctr");
+         }
+       dlRsrpSinrStats.Install (ueDevs);
+       DlRsrpSinrColumnarSink::EnableLteTraces (lteHelper);
+     }
+   else
+     {
+       lteHelper->EnableTraces ();
+     }
+   FastExit::AddLteStats (lteHelper);
 
     centralServerApps.Start (Seconds (0.001));
     centralClientApps.Start (Seconds (0.001));
@@ -351,11 +347,16 @@ int main(int argc, char** argv) {
 
     NS_LOG_INFO("Scheduling events for position tracing");
 
-    for(uint32_t u=0;u<nUes;++u){
-        for(double j=1;j<=simTime;++j){
-            Simulator::Schedule(Time(Seconds(j)),CourseChange,ueNodes.Get(u));
-        }
-    }
+    // Posizioni e velocità di tutti gli UE ogni secondo, un solo evento per campione
+    MobilitySampler positionTrace;
+    positionTrace.Add(ueNodes);
+    bool positionBinary = (positionFormat == "bin");
+    if (!positionTrace.Open (positionBinary ? "PositionTrace.bin" : "PositionTrace.csv",
+                             positionBinary ? MobilitySampler::BINARY : MobilitySampler::CSV))
+      {
+        NS_FATAL_ERROR ("Can't create PositionTrace");
+      }
+    positionTrace.Start (Seconds (1), Seconds (1));
 
     for( uint32_t t = 0; t <= simTime; t++ ) {
         Simulator::Schedule( Time(Seconds(simTime)), ReportProgress );
@@ -370,7 +371,18 @@ int main(int argc, char** argv) {
                  << " stream_x = " << stream
                  << " rateSingle = " <<rate.str() );
 
+    Simulator::Stop (Seconds (simTime));
+    PhaseTimer::Get ().Begin ("run");
    Simulator::Run ();
+    PhaseTimer::Get ().End ();
+    EventProfiler::Report ("EventProfile.txt");    // con --profileEvents
+    CachedPropagationLossModel::Report (std::cout);    // con --cachePathloss
+    PhaseTimer::Get ().SetValue ("events", Simulator::GetEventCount ());
+    PhaseTimer::Get ().SetValue ("sim_s", Simulator::Now ().GetSeconds ());
+    PhaseTimer::Get ().SetValue ("packet_pool_hits", PacketPool::Get ().GetHits ());
+    PhaseTimer::Get ().SetValue ("packet_pool_misses", PacketPool::Get ().GetMisses ());
+    PhaseTimer::Get ().SetValue ("packet_pool_peak", PacketPool::Get ().GetPeakOccupancy ());
+   dlRsrpSinrStats.Close ();
 
    //Prendiamo i risultati
     rusage ru;
@@ -391,9 +403,17 @@ int main(int argc, char** argv) {
     //std::cout<<"RxTotBytesError= "<<size_rx_err<<std::endl;
     //NS_LOG_INFO("RxTotBytesError= "<<size_rx_err);
 
-    outfile_pos.close();
+    positionTrace.Stop ();
+
+    PhaseTimer::Get ().Begin ("destroy");
+   FastExit::Destroy ();    // con --fastExit scrive solo le tracce
+    PhaseTimer::Get ().End ();
+
+    // Tempo e memoria di picco di ogni fase
+    PhaseTimer::Get ().Print (std::cout);
+    PhaseTimer::Get ().WriteJson ("PhaseTimes.json");
 
-   Simulator::Destroy ();
+    FastExit::Exit (0);    // con --fastExit niente distruzione
 
     return 0;
 }
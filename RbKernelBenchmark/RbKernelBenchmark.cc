@@ -0,0 +1,323 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Micro-benchmark of the per-RB kernels of common/rb-kernels.h.
+//
+// Each operation of the per-RB pipeline is timed three ways on the same
+// random data:
+//  - "spectrum": SpectrumValue arithmetic, as LteInterference and the
+//    fading models do it (a new SpectrumValue per operator, the fading
+//    converted from dB with a pow per RB)
+//  - "loop": a plain loop over std::vector<double>, left to the compiler
+//  - "simd": the RbAccumulate/RbMultiply/RbSinr kernels on RbPowerVectors
+// The operations are the sum of the interferers, applying a fading
+// realization and the SINR of every RB. Results are checked against each
+// other, the run failing if they differ by more than 1e-12 (1e-6 for the
+// single precision fading gains), and the timings printed as ns per
+// operation, with the speedup of every path over "spectrum":
+//
+//   op,path,rbs,interferers,ns_per_op,speedup
+//
+// Build optimized (./waf configure --build-profile=optimized) to get the
+// AVX path; the SIMD width of the build is printed first.
+//
+// ./waf --run "scratch/RbKernelBenchmark/RbKernelBenchmark --rbs=100 --interferers=56"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ns3/core-module.h"
+#include "ns3/lte-spectrum-value-helper.h"
+#include "ns3/spectrum-value.h"
+
+#include "../common/rb-kernels.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("RbKernelBenchmark");
+
+namespace {
+
+struct Timing
+{
+  std::string op;
+  std::string path;
+  double nsPerOp;
+};
+
+double
+NsPerOp (std::chrono::steady_clock::time_point start, uint32_t ops)
+{
+  std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now () - start;
+  return elapsed.count () / ops;
+}
+
+// Largest relative difference between two per-RB results
+double
+MaxRelativeError (const double *a, const double *b, uint32_t n)
+{
+  double err = 0;
+  for (uint32_t i = 0; i < n; i++)
+    {
+      double scale = std::max (std::fabs (a[i]), std::fabs (b[i]));
+      if (scale > 0)
+        {
+          err = std::max (err, std::fabs (a[i] - b[i]) / scale);
+        }
+    }
+  return err;
+}
+
+} // namespace
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t rbs = 100;
+  uint32_t interferers = 56;
+  uint32_t iterations = 20000;
+  uint32_t seed = 1;
+  std::string csv = "";
+
+  CommandLine cmd;
+  cmd.AddValue ("rbs", "Resource blocks, 6, 15, 25, 50, 75 or 100", rbs);
+  cmd.AddValue ("interferers", "Signals summed in the interference of a receiver", interferers);
+  cmd.AddValue ("iterations", "Repetitions of every operation", iterations);
+  cmd.AddValue ("seed", "Seed of the random PSDs and gains", seed);
+  cmd.AddValue ("csv", "Also write the timings to this file", csv);
+  cmd.Parse (argc, argv);
+
+  if (interferers == 0 || iterations == 0)
+    {
+      NS_FATAL_ERROR ("--interferers and --iterations must be positive");
+    }
+
+  // Random PSDs of the interferers, noise, and a fading column in dB
+  Ptr<SpectrumModel> model = LteSpectrumValueHelper::GetSpectrumModel (100, rbs);
+  std::srand (seed);
+  std::vector<Ptr<SpectrumValue> > psds;
+  std::vector<RbPowerVector> vectors (interferers + 1, RbPowerVector (rbs));
+  std::vector<std::vector<double> > plain (interferers + 1, std::vector<double> (rbs));
+  for (uint32_t s = 0; s <= interferers; s++)
+    {
+      Ptr<SpectrumValue> psd = Create<SpectrumValue> (model);
+      for (uint32_t i = 0; i < rbs; i++)
+        {
+          double value = std::pow (10.0, -(std::rand () % 600) / 100.0) * 1e-16;
+          (*psd)[i] = value;
+          vectors[s][i] = value;
+          plain[s][i] = value;
+        }
+      psds.push_back (psd);
+    }
+  SpectrumValue noiseSv (model);
+  RbPowerVector noise (rbs);
+  std::vector<double> noisePlain (rbs);
+  std::vector<float> fadingDb (rbs);
+  std::vector<float> fadingLinear (rbs);
+  std::vector<double> fadingLinearPlain (rbs);
+  for (uint32_t i = 0; i < rbs; i++)
+    {
+      noiseSv[i] = noise[i] = noisePlain[i] = 1e-20;
+      fadingDb[i] = (std::rand () % 4000) / 100.0f - 30.0f;
+    }
+  RbDbToLinear (&fadingLinear[0], &fadingDb[0], 1, rbs);
+  for (uint32_t i = 0; i < rbs; i++)
+    {
+      fadingLinearPlain[i] = fadingLinear[i];
+    }
+
+  std::cout << "SIMD width " << RbSimdWidth () << " doubles, " << rbs << " RBs, "
+            << interferers << " interferers, " << iterations << " iterations" << std::endl;
+  std::vector<Timing> timings;
+  double sink = 0;    // keeps the results alive
+
+  // Interference: sum of the interferer PSDs (1..interferers)
+  SpectrumValue sumSv (model);
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+  for (uint32_t it = 0; it < iterations; it++)
+    {
+      sumSv = SpectrumValue (model);
+      for (uint32_t s = 1; s <= interferers; s++)
+        {
+          sumSv += *psds[s];
+        }
+      sink += sumSv[it % rbs];
+    }
+  Timing t = { "interference", "spectrum", NsPerOp (start, iterations) };
+  timings.push_back (t);
+
+  std::vector<double> sumPlain (rbs);
+  start = std::chrono::steady_clock::now ();
+  for (uint32_t it = 0; it < iterations; it++)
+    {
+      std::fill (sumPlain.begin (), sumPlain.end (), 0.0);
+      for (uint32_t s = 1; s <= interferers; s++)
+        {
+          for (uint32_t i = 0; i < rbs; i++)
+            {
+              sumPlain[i] += plain[s][i];
+            }
+        }
+      sink += sumPlain[it % rbs];
+    }
+  t.path = "loop";
+  t.nsPerOp = NsPerOp (start, iterations);
+  timings.push_back (t);
+
+  RbPowerVector sum (rbs);
+  start = std::chrono::steady_clock::now ();
+  for (uint32_t it = 0; it < iterations; it++)
+    {
+      sum.Fill (0);
+      for (uint32_t s = 1; s <= interferers; s++)
+        {
+          sum += vectors[s];
+        }
+      sink += sum[it % rbs];
+    }
+  t.path = "simd";
+  t.nsPerOp = NsPerOp (start, iterations);
+  timings.push_back (t);
+  double errInterference = std::max (MaxRelativeError (sum.Data (), &sumPlain[0], rbs),
+                                     MaxRelativeError (sum.Data (), &sumSv[0], rbs));
+
+  // Fading: the signal PSD (0) times a fading column
+  SpectrumValue fadedSv (model);
+  start = std::chrono::steady_clock::now ();
+  for (uint32_t it = 0; it < iterations; it++)
+    {
+      Ptr<SpectrumValue> rx = Copy<SpectrumValue> (psds[0]);
+      uint32_t i = 0;
+      for (Values::iterator vit = rx->ValuesBegin (); vit != rx->ValuesEnd (); ++vit, ++i)
+        {
+          *vit *= std::pow (10.0, fadingDb[i] / 10.0);
+        }
+      fadedSv = *rx;
+      sink += fadedSv[it % rbs];
+    }
+  t.op = "fading";
+  t.path = "spectrum";
+  t.nsPerOp = NsPerOp (start, iterations);
+  timings.push_back (t);
+
+  std::vector<double> fadedPlain (rbs);
+  start = std::chrono::steady_clock::now ();
+  for (uint32_t it = 0; it < iterations; it++)
+    {
+      for (uint32_t i = 0; i < rbs; i++)
+        {
+          fadedPlain[i] = plain[0][i] * fadingLinearPlain[i];
+        }
+      sink += fadedPlain[it % rbs];
+    }
+  t.path = "loop";
+  t.nsPerOp = NsPerOp (start, iterations);
+  timings.push_back (t);
+
+  RbPowerVector faded (rbs);
+  start = std::chrono::steady_clock::now ();
+  for (uint32_t it = 0; it < iterations; it++)
+    {
+      faded = vectors[0];
+      RbMultiply (faded.Data (), &fadingLinear[0], rbs);
+      sink += faded[it % rbs];
+    }
+  t.path = "simd";
+  t.nsPerOp = NsPerOp (start, iterations);
+  timings.push_back (t);
+  double errFading = std::max (MaxRelativeError (faded.Data (), &fadedPlain[0], rbs),
+                               MaxRelativeError (faded.Data (), &fadedSv[0], rbs));
+
+  // SINR of the faded signal against the interference and the noise
+  SpectrumValue sinrSv (model);
+  start = std::chrono::steady_clock::now ();
+  for (uint32_t it = 0; it < iterations; it++)
+    {
+      sinrSv = fadedSv / (sumSv + noiseSv);
+      sink += sinrSv[it % rbs];
+    }
+  t.op = "sinr";
+  t.path = "spectrum";
+  t.nsPerOp = NsPerOp (start, iterations);
+  timings.push_back (t);
+
+  std::vector<double> sinrPlain (rbs);
+  start = std::chrono::steady_clock::now ();
+  for (uint32_t it = 0; it < iterations; it++)
+    {
+      for (uint32_t i = 0; i < rbs; i++)
+        {
+          sinrPlain[i] = fadedPlain[i] / (sumPlain[i] + noisePlain[i]);
+        }
+      sink += sinrPlain[it % rbs];
+    }
+  t.path = "loop";
+  t.nsPerOp = NsPerOp (start, iterations);
+  timings.push_back (t);
+
+  RbPowerVector sinr (rbs);
+  start = std::chrono::steady_clock::now ();
+  for (uint32_t it = 0; it < iterations; it++)
+    {
+      RbSinr (sinr.Data (), faded.Data (), sum.Data (), noise.Data (), rbs);
+      sink += sinr[it % rbs];
+    }
+  t.path = "simd";
+  t.nsPerOp = NsPerOp (start, iterations);
+  timings.push_back (t);
+  // sinrSv is computed from fadedSv and carries its difference, checked above
+  double errSinr = MaxRelativeError (sinr.Data (), &sinrPlain[0], rbs);
+
+  // The fading gains are single precision in the kernels, as in the traces
+  std::cout << "Max relative difference: interference " << errInterference << ", fading "
+            << errFading << ", sinr " << errSinr << " (checksum " << sink << ")" << std::endl;
+  if (errInterference > 1e-12 || errFading > 1e-6 || errSinr > 1e-12)
+    {
+      NS_FATAL_ERROR ("The kernels differ from the reference beyond tolerance "
+                      "(1e-12, 1e-6 for the single precision fading gains)");
+    }
+
+  std::ostringstream table;
+  table << "op,path,rbs,interferers,ns_per_op,speedup" << std::endl;
+  for (uint32_t i = 0; i < timings.size (); i++)
+    {
+      double reference = timings[i - i % 3].nsPerOp;   // the spectrum row of the op
+      table << timings[i].op << "," << timings[i].path << "," << rbs << "," << interferers << ","
+            << std::fixed << std::setprecision (1) << timings[i].nsPerOp << ","
+            << std::setprecision (2) << reference / timings[i].nsPerOp << std::endl;
+    }
+  std::cout << table.str ();
+  if (!csv.empty ())
+    {
+      std::ofstream file (csv.c_str ());
+      if (!file.is_open ())
+        {
+          NS_FATAL_ERROR ("Can't write " << csv);
+        }
+      file << table.str ();
+    }
+
+  return 0;
+}
@@ -0,0 +1,176 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef ASYNC_BLOCK_WRITER_H
+#define ASYNC_BLOCK_WRITER_H
+
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * Appends blocks of bytes to a file from a background thread.
+ *
+ * The simulation thread hands over a filled buffer with Write () and gets an
+ * empty, recycled one back, so steady state runs without allocations. At
+ * most maxQueuedBlocks blocks wait for the disk: when the writer falls behind
+ * Write () blocks instead of letting memory grow with the run length.
+ */
+class AsyncBlockWriter
+{
+public:
+  AsyncBlockWriter ()
+    : m_file (0),
+      m_maxQueuedBlocks (4),
+      m_closing (false),
+      m_error (false)
+  {
+  }
+
+  ~AsyncBlockWriter ()
+  {
+    Close ();
+  }
+
+  /**
+   * \param filename file to create (truncated if it exists)
+   * \param maxQueuedBlocks blocks allowed to wait for the writer thread
+   * \return false if the file can't be created
+   */
+  bool
+  Open (const std::string &filename, uint32_t maxQueuedBlocks = 4)
+  {
+    Close ();
+    m_file = std::fopen (filename.c_str (), "wb");
+    if (m_file == 0)
+      {
+        return false;
+      }
+    m_maxQueuedBlocks = maxQueuedBlocks > 0 ? maxQueuedBlocks : 1;
+    m_closing = false;
+    m_error = false;
+    m_thread = std::thread (&AsyncBlockWriter::Run, this);
+    return true;
+  }
+
+  bool
+  IsOpen (void) const
+  {
+    return m_file != 0;
+  }
+
+  /**
+   * Queue the content of block for writing. On return block is empty (and
+   * possibly holds the capacity of a previously written block).
+   */
+  void
+  Write (std::vector<char> &block)
+  {
+    if (block.empty ())
+      {
+        return;
+      }
+    std::unique_lock<std::mutex> lock (m_mutex);
+    m_notFull.wait (lock, [this] { return m_queue.size () < m_maxQueuedBlocks; });
+    m_queue.push_back (std::vector<char> ());
+    m_queue.back ().swap (block);
+    if (!m_free.empty ())
+      {
+        block.swap (m_free.back ());
+        m_free.pop_back ();
+      }
+    block.clear ();
+    m_notEmpty.notify_one ();
+  }
+
+  /**
+   * Write every queued block, stop the thread and close the file.
+   * \return false if any write failed
+   */
+  bool
+  Close (void)
+  {
+    if (m_file == 0)
+      {
+        return !m_error;
+      }
+    {
+      std::lock_guard<std::mutex> lock (m_mutex);
+      m_closing = true;
+    }
+    m_notEmpty.notify_one ();
+    m_thread.join ();
+    if (std::fclose (m_file) != 0)
+      {
+        m_error = true;
+      }
+    m_file = 0;
+    m_free.clear ();
+    return !m_error;
+  }
+
+private:
+  void
+  Run (void)
+  {
+    std::vector<char> block;
+    while (true)
+      {
+        {
+          std::unique_lock<std::mutex> lock (m_mutex);
+          if (!block.empty ())
+            {
+              block.clear ();
+              m_free.push_back (std::vector<char> ());
+              m_free.back ().swap (block);
+            }
+          m_notEmpty.wait (lock, [this] { return m_closing || !m_queue.empty (); });
+          if (m_queue.empty ())
+            {
+              return;
+            }
+          block.swap (m_queue.front ());
+          m_queue.pop_front ();
+        }
+        m_notFull.notify_one ();
+        if (std::fwrite (&block[0], 1, block.size (), m_file) != block.size ())
+          {
+            m_error = true;
+          }
+      }
+  }
+
+  std::FILE *m_file;
+  std::thread m_thread;
+  std::mutex m_mutex;
+  std::condition_variable m_notEmpty;
+  std::condition_variable m_notFull;
+  std::deque<std::vector<char> > m_queue;   // blocks waiting for the disk
+  std::deque<std::vector<char> > m_free;    // written blocks, recycled by Write ()
+  uint32_t m_maxQueuedBlocks;
+  bool m_closing;
+  bool m_error;
+};
+
+} // namespace ns3
+
+#endif /* ASYNC_BLOCK_WRITER_H */
@@ -0,0 +1,305 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef CACHED_PROPAGATION_LOSS_MODEL_H
+#define CACHED_PROPAGATION_LOSS_MODEL_H
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <stdint.h>
+
+#include "ns3/abort.h"
+#include "ns3/callback.h"
+#include "ns3/double.h"
+#include "ns3/lte-helper.h"
+#include "ns3/mobility-model.h"
+#include "ns3/object-factory.h"
+#include "ns3/propagation-loss-model.h"
+#include "ns3/string.h"
+#include "ns3/type-id.h"
+
+namespace ns3 {
+
+/**
+ * Caches the loss of another PropagationLossModel per (tx, rx) mobility
+ * model pair.
+ *
+ * The loss is only cached while both ends stand still: a mobility model
+ * with zero velocity keeps its position until its course changes, and a
+ * course change fires CourseChange, which invalidates the entries of that
+ * model (a version bump, the entries are recomputed on their next use).
+ * Pairs with a moving end go straight to the wrapped model. Static drops
+ * (ConstantPositionMobilityModel, paused waypoints) pay for the pathloss
+ * formula once per pair instead of once per transmission.
+ *
+ * The wrapped model must be deterministic, i.e. give the same loss for the
+ * same positions (Friis, OkumuraHata, Cost231, ...): a random shadowing
+ * model would be frozen at its first draw. The carrier frequency set by
+ * LteHelper through "Frequency" is passed on, the other attributes of the
+ * wrapped model come from its defaults (Config::SetDefault).
+ *
+ *   SetPathlossModel (lteHelper, "ns3::OkumuraHataPropagationLossModel", cachePathloss);
+ *   ...
+ *   CachedPropagationLossModel::Report (std::cout);
+ */
+class CachedPropagationLossModel : public PropagationLossModel
+{
+public:
+  static TypeId
+  GetTypeId (void)
+  {
+    static TypeId tid = TypeId ("ns3::CachedPropagationLossModel")
+      .SetParent<PropagationLossModel> ()
+      .SetGroupName ("Propagation")
+      .AddConstructor<CachedPropagationLossModel> ()
+      .AddAttribute ("Model", "TypeId of the wrapped propagation loss model",
+                     StringValue ("ns3::FriisPropagationLossModel"),
+                     MakeStringAccessor (&CachedPropagationLossModel::SetModel,
+                                         &CachedPropagationLossModel::GetModel),
+                     MakeStringChecker ())
+      .AddAttribute ("Frequency", "Carrier frequency (Hz) passed on to the wrapped model, 0 to leave it",
+                     DoubleValue (0),
+                     MakeDoubleAccessor (&CachedPropagationLossModel::SetFrequency,
+                                         &CachedPropagationLossModel::GetFrequency),
+                     MakeDoubleChecker<double> ())
+    ;
+    return tid;
+  }
+
+  CachedPropagationLossModel ()
+    : m_frequency (0),
+      m_hits (0),
+      m_misses (0),
+      m_bypassed (0),
+      m_invalidations (0)
+  {
+    GetInstances ().push_back (this);
+  }
+
+  virtual
+  ~CachedPropagationLossModel ()
+  {
+    std::vector<CachedPropagationLossModel *> &instances = GetInstances ();
+    instances.erase (std::remove (instances.begin (), instances.end (), this), instances.end ());
+  }
+
+  uint64_t GetHits (void) const { return m_hits; }
+  uint64_t GetMisses (void) const { return m_misses; }
+  uint64_t GetBypassed (void) const { return m_bypassed; }
+
+  /// Approximate memory of the cache, entries and hash buckets
+  uint64_t
+  GetMemoryBytes (void) const
+  {
+    return m_cache.size () * (sizeof (Key) + sizeof (Entry) + 2 * sizeof (void *))
+      + m_cache.bucket_count () * sizeof (void *)
+      + m_models.size () * (sizeof (const MobilityModel *) + sizeof (uint32_t) + 2 * sizeof (void *))
+      + m_models.bucket_count () * sizeof (void *);
+  }
+
+  /// Hit rate and memory of every cache alive (e.g. the DL and UL channels)
+  static void
+  Report (std::ostream &os)
+  {
+    const std::vector<CachedPropagationLossModel *> &instances = GetInstances ();
+    for (uint32_t i = 0; i < instances.size (); i++)
+      {
+        const CachedPropagationLossModel *c = instances[i];
+        uint64_t lookups = c->m_hits + c->m_misses + c->m_bypassed;
+        os << "Pathloss cache " << i << " (" << c->GetModel () << "): " << lookups << " lookups, "
+           << (lookups > 0 ? 100.0 * c->m_hits / lookups : 0) << "% hits, "
+           << c->m_misses << " misses, " << c->m_bypassed << " moving, "
+           << c->m_invalidations << " course changes, " << c->m_cache.size () << " pairs, "
+           << c->GetMemoryBytes () / 1024 << " KiB" << std::endl;
+      }
+  }
+
+private:
+  typedef std::pair<const MobilityModel *, const MobilityModel *> Key;
+
+  struct KeyHash
+  {
+    size_t
+    operator() (const Key &k) const
+    {
+      return std::hash<const void *> () (k.first) * 31 + std::hash<const void *> () (k.second);
+    }
+  };
+
+  struct Entry
+  {
+    double loss;
+    const uint32_t *txVersion;    // into m_models, stable in an unordered_map
+    const uint32_t *rxVersion;
+    uint32_t txSeen;
+    uint32_t rxSeen;
+  };
+
+  virtual double
+  DoCalcRxPower (double txPowerDbm, Ptr<MobilityModel> a, Ptr<MobilityModel> b) const
+  {
+    if (!IsStill (a) || !IsStill (b))
+      {
+        m_bypassed++;
+        return m_model->CalcRxPower (txPowerDbm, a, b);
+      }
+    Key key (PeekPointer (a), PeekPointer (b));
+    std::unordered_map<Key, Entry, KeyHash>::iterator it = m_cache.find (key);
+    if (it != m_cache.end () && *it->second.txVersion == it->second.txSeen
+        && *it->second.rxVersion == it->second.rxSeen)
+      {
+        m_hits++;
+        return txPowerDbm - it->second.loss;
+      }
+    m_misses++;
+    double rxPowerDbm = m_model->CalcRxPower (txPowerDbm, a, b);
+    Entry &entry = m_cache[key];
+    entry.loss = txPowerDbm - rxPowerDbm;
+    entry.txVersion = Track (a);
+    entry.rxVersion = Track (b);
+    entry.txSeen = *entry.txVersion;
+    entry.rxSeen = *entry.rxVersion;
+    return rxPowerDbm;
+  }
+
+  virtual int64_t
+  DoAssignStreams (int64_t stream)
+  {
+    return m_model->AssignStreams (stream);
+  }
+
+  virtual void
+  DoDispose (void)
+  {
+    m_cache.clear ();
+    m_model = 0;
+    PropagationLossModel::DoDispose ();
+  }
+
+  static bool
+  IsStill (Ptr<MobilityModel> model)
+  {
+    Vector v = model->GetVelocity ();
+    return v.x == 0 && v.y == 0 && v.z == 0;
+  }
+
+  // Version of the model, bumped by its CourseChange (connected the first time)
+  const uint32_t *
+  Track (Ptr<MobilityModel> model) const
+  {
+    std::unordered_map<const MobilityModel *, uint32_t>::iterator it = m_models.find (PeekPointer (model));
+    if (it == m_models.end ())
+      {
+        it = m_models.insert (std::make_pair (PeekPointer (model), 0)).first;
+        model->TraceConnectWithoutContext ("CourseChange",
+                                           MakeCallback (&CachedPropagationLossModel::CourseChanged,
+                                                         const_cast<CachedPropagationLossModel *> (this)));
+      }
+    return &it->second;
+  }
+
+  void
+  CourseChanged (Ptr<const MobilityModel> model)
+  {
+    m_models[PeekPointer (model)]++;
+    m_invalidations++;
+  }
+
+  void
+  SetModel (std::string name)
+  {
+    ObjectFactory factory;
+    factory.SetTypeId (name);
+    m_model = factory.Create<PropagationLossModel> ();
+    m_cache.clear ();
+    SetFrequency (m_frequency);
+  }
+
+  std::string GetModel (void) const { return m_model != 0 ? m_model->GetInstanceTypeId ().GetName () : ""; }
+
+  void
+  SetFrequency (double frequency)
+  {
+    m_frequency = frequency;
+    if (m_model != 0 && frequency > 0)
+      {
+        m_model->SetAttributeFailSafe ("Frequency", DoubleValue (frequency));
+        m_cache.clear ();
+      }
+  }
+
+  double GetFrequency (void) const { return m_frequency; }
+
+  static std::vector<CachedPropagationLossModel *> &
+  GetInstances (void)
+  {
+    static std::vector<CachedPropagationLossModel *> instances;
+    return instances;
+  }
+
+  Ptr<PropagationLossModel> m_model;
+  double m_frequency;
+  mutable std::unordered_map<Key, Entry, KeyHash> m_cache;
+  mutable std::unordered_map<const MobilityModel *, uint32_t> m_models;
+  mutable uint64_t m_hits;
+  mutable uint64_t m_misses;
+  mutable uint64_t m_bypassed;
+  uint64_t m_invalidations;
+};
+
+/**
+ * Use 'model' for the pathloss of lteHelper, behind a
+ * CachedPropagationLossModel when 'cache' is set. Set the attributes of
+ * the model with Config::SetDefault, they do not reach it through
+ * SetPathlossModelAttribute when it is cached.
+ */
+inline void
+SetPathlossModel (Ptr<LteHelper> lteHelper, std::string model, bool cache)
+{
+  if (cache)
+    {
+      CachedPropagationLossModel::GetTypeId ();   // registers the TypeId name
+      lteHelper->SetAttribute ("PathlossModel", StringValue ("ns3::CachedPropagationLossModel"));
+      lteHelper->SetPathlossModelAttribute ("Model", StringValue (model));
+    }
+  else
+    {
+      lteHelper->SetAttribute ("PathlossModel", StringValue (model));
+    }
+}
+
+/**
+ * Put the pathloss model lteHelper was created with, the
+ * ns3::LteHelper::PathlossModel default (e.g. from a ConfigStore file),
+ * behind a CachedPropagationLossModel. Call it before SetAttribute
+ * ("PathlossModel") on the helper, which it doesn't see.
+ */
+inline void
+CacheDefaultPathlossModel (Ptr<LteHelper> lteHelper)
+{
+  struct TypeId::AttributeInformation info;
+  bool found = LteHelper::GetTypeId ().LookupAttributeByName ("PathlossModel", &info);
+  NS_ABORT_MSG_IF (!found, "CacheDefaultPathlossModel: LteHelper has no PathlossModel attribute");
+  SetPathlossModel (lteHelper, info.initialValue->SerializeToString (info.checker), true);
+}
+
+} // namespace ns3
+
+#endif /* CACHED_PROPAGATION_LOSS_MODEL_H */
@@ -0,0 +1,240 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef COLUMNAR_TRACE_WRITER_H
+#define COLUMNAR_TRACE_WRITER_H
+
+/*
+ * Block-columnar trace format (.ctr), version 1
+ *
+ * A little-endian header describing the columns, followed by blocks of up to
+ * RowsPerBlock rows each, stored column after column:
+ *
+ *   header:  magic "COLTRACE" (8 bytes), version (uint32), number of columns
+ *            (uint32), then for every column its type (uint8), the length of
+ *            its name (uint8) and the name
+ *   block:   number of rows (uint32), then for every column the size of its
+ *            data in bytes (uint32) and the data
+ *
+ * Column types:
+ *   0 TIME   simulation time in ns, encoded as UINT
+ *   1 UINT   integers, first value then deltas, zigzag varint (LEB128)
+ *   2 FLOAT  raw float32
+ *
+ * Deltas restart at every block, so blocks decode independently. Times,
+ * cell ids, IMSIs and RNTIs mostly take one or two bytes per row this way.
+ * See read_columnar_trace.jl for a reader.
+ */
+
+#include <cstring>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "async-block-writer.h"
+
+namespace ns3 {
+
+class ColumnarTraceWriter
+{
+public:
+  enum ColumnType
+  {
+    TIME = 0,
+    UINT = 1,
+    FLOAT = 2
+  };
+
+  ColumnarTraceWriter ()
+    : m_rowsPerBlock (0),
+      m_rows (0)
+  {
+  }
+
+  ~ColumnarTraceWriter ()
+  {
+    Close ();
+  }
+
+  /**
+   * Add a column; all columns must be added before Open ().
+   * \return the index to pass to the Set* methods
+   */
+  uint32_t
+  AddColumn (const std::string &name, ColumnType type)
+  {
+    Column column;
+    column.name = name.substr (0, 255);
+    column.type = type;
+    m_columns.push_back (column);
+    return m_columns.size () - 1;
+  }
+
+  /**
+   * \param filename trace file to create
+   * \param rowsPerBlock rows buffered before a block is handed to the writer thread
+   * \param maxQueuedBlocks encoded blocks allowed to wait for the disk
+   * \return false if the file can't be created
+   */
+  bool
+  Open (const std::string &filename, uint32_t rowsPerBlock = 65536, uint32_t maxQueuedBlocks = 4)
+  {
+    if (!m_writer.Open (filename, maxQueuedBlocks))
+      {
+        return false;
+      }
+    m_rowsPerBlock = rowsPerBlock > 0 ? rowsPerBlock : 1;
+    m_rows = 0;
+    for (uint32_t c = 0; c < m_columns.size (); c++)
+      {
+        m_columns[c].ints.reserve (m_columns[c].type == FLOAT ? 0 : m_rowsPerBlock);
+        m_columns[c].floats.reserve (m_columns[c].type == FLOAT ? m_rowsPerBlock : 0);
+      }
+
+    m_block.insert (m_block.end (), "COLTRACE", "COLTRACE" + 8);
+    PutUint32 (1);
+    PutUint32 (m_columns.size ());
+    for (uint32_t c = 0; c < m_columns.size (); c++)
+      {
+        m_block.push_back (m_columns[c].type);
+        m_block.push_back (m_columns[c].name.size ());
+        m_block.insert (m_block.end (), m_columns[c].name.begin (), m_columns[c].name.end ());
+      }
+    m_writer.Write (m_block);
+    return true;
+  }
+
+  bool
+  IsOpen (void) const
+  {
+    return m_writer.IsOpen ();
+  }
+
+  void
+  SetTime (uint32_t column, int64_t nanoSeconds)
+  {
+    m_columns[column].ints.push_back (nanoSeconds);
+  }
+
+  void
+  SetUint (uint32_t column, uint64_t value)
+  {
+    m_columns[column].ints.push_back (value);
+  }
+
+  void
+  SetFloat (uint32_t column, float value)
+  {
+    m_columns[column].floats.push_back (value);
+  }
+
+  /// Complete the row after setting every column once
+  void
+  EndRow (void)
+  {
+    if (++m_rows == m_rowsPerBlock)
+      {
+        Flush ();
+      }
+  }
+
+  /// Hand the buffered rows to the writer thread as a (possibly short) block
+  void
+  Flush (void)
+  {
+    if (m_rows == 0)
+      {
+        return;
+      }
+    PutUint32 (m_rows);
+    for (uint32_t c = 0; c < m_columns.size (); c++)
+      {
+        Column &column = m_columns[c];
+        size_t sizeOffset = m_block.size ();
+        PutUint32 (0);
+        if (column.type == FLOAT)
+          {
+            const char *data = reinterpret_cast<const char *> (column.floats.data ());
+            m_block.insert (m_block.end (), data, data + column.floats.size () * sizeof (float));
+            column.floats.clear ();
+          }
+        else
+          {
+            int64_t previous = 0;
+            for (size_t i = 0; i < column.ints.size (); i++)
+              {
+                int64_t delta = column.ints[i] - previous;
+                previous = column.ints[i];
+                PutVarint ((static_cast<uint64_t> (delta) << 1) ^ static_cast<uint64_t> (delta >> 63));
+              }
+            column.ints.clear ();
+          }
+        uint32_t size = m_block.size () - sizeOffset - sizeof (uint32_t);
+        std::memcpy (&m_block[sizeOffset], &size, sizeof (size));
+      }
+    m_rows = 0;
+    m_writer.Write (m_block);
+  }
+
+  /// Flush the last block and wait for everything to reach the file
+  bool
+  Close (void)
+  {
+    if (!m_writer.IsOpen ())
+      {
+        return true;
+      }
+    Flush ();
+    return m_writer.Close ();
+  }
+
+private:
+  struct Column
+  {
+    std::string name;
+    ColumnType type;
+    std::vector<int64_t> ints;
+    std::vector<float> floats;
+  };
+
+  void
+  PutUint32 (uint32_t value)
+  {
+    const char *data = reinterpret_cast<const char *> (&value);
+    m_block.insert (m_block.end (), data, data + sizeof (value));
+  }
+
+  void
+  PutVarint (uint64_t value)
+  {
+    while (value >= 0x80)
+      {
+        m_block.push_back (static_cast<char> ((value & 0x7f) | 0x80));
+        value >>= 7;
+      }
+    m_block.push_back (static_cast<char> (value));
+  }
+
+  std::vector<Column> m_columns;
+  std::vector<char> m_block;        // block being encoded, swapped with the writer
+  AsyncBlockWriter m_writer;
+  uint32_t m_rowsPerBlock;
+  uint32_t m_rows;
+};
+
+} // namespace ns3
+
+#endif /* COLUMNAR_TRACE_WRITER_H */
@@ -0,0 +1,145 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef DL_RSRP_SINR_COLUMNAR_SINK_H
+#define DL_RSRP_SINR_COLUMNAR_SINK_H
+
+#include <deque>
+#include <string>
+
+#include "ns3/callback.h"
+#include "ns3/lte-helper.h"
+#include "ns3/lte-ue-net-device.h"
+#include "ns3/lte-ue-phy.h"
+#include "ns3/net-device-container.h"
+#include "ns3/simulator.h"
+
+#include "columnar-trace-writer.h"
+
+namespace ns3 {
+
+/**
+ * Writes the records of DlRsrpSinrStats.txt (time, cellId, IMSI, RNTI, RSRP
+ * and SINR, both linear) to a columnar trace instead of text.
+ *
+ *   DlRsrpSinrColumnarSink dlStats;
+ *   dlStats.Open ("DlRsrpSinrStats.ctr");
+ *   dlStats.Install (ueDevs);
+ *   DlRsrpSinrColumnarSink::EnableLteTraces (lteHelper);  // instead of lteHelper->EnableTraces ()
+ *   Simulator::Run ();
+ *   dlStats.Close ();
+ */
+class DlRsrpSinrColumnarSink
+{
+public:
+  DlRsrpSinrColumnarSink ()
+  {
+    m_time = m_trace.AddColumn ("time", ColumnarTraceWriter::TIME);
+    m_cellId = m_trace.AddColumn ("cellId", ColumnarTraceWriter::UINT);
+    m_imsi = m_trace.AddColumn ("IMSI", ColumnarTraceWriter::UINT);
+    m_rnti = m_trace.AddColumn ("RNTI", ColumnarTraceWriter::UINT);
+    m_rsrp = m_trace.AddColumn ("rsrp", ColumnarTraceWriter::FLOAT);
+    m_sinr = m_trace.AddColumn ("sinr", ColumnarTraceWriter::FLOAT);
+  }
+
+  bool
+  Open (const std::string &filename, uint32_t rowsPerBlock = 65536)
+  {
+    return m_trace.Open (filename, rowsPerBlock);
+  }
+
+  /// Connect to the ReportCurrentCellRsrpSinr trace of every UE in ueDevs
+  void
+  Install (NetDeviceContainer ueDevs)
+  {
+    for (NetDeviceContainer::Iterator it = ueDevs.Begin (); it != ueDevs.End (); ++it)
+      {
+        Install (*it);
+      }
+  }
+
+  void
+  Install (Ptr<NetDevice> ueDev)
+  {
+    Ptr<LteUeNetDevice> lteUeDev = ueDev->GetObject<LteUeNetDevice> ();
+    NS_ASSERT_MSG (lteUeDev != 0, "DlRsrpSinrColumnarSink can only be installed on LTE UEs");
+    // The IMSI is bound to the callback, no lookup from the trace context
+    m_ues.push_back (UeBinding ());
+    m_ues.back ().sink = this;
+    m_ues.back ().imsi = lteUeDev->GetImsi ();
+    lteUeDev->GetPhy ()->TraceConnectWithoutContext ("ReportCurrentCellRsrpSinr",
+                                                     MakeBoundCallback (&DlRsrpSinrColumnarSink::ReportCurrentCellRsrpSinr,
+                                                                        &m_ues.back ()));
+  }
+
+  bool
+  Close (void)
+  {
+    return m_trace.Close ();
+  }
+
+  /// Enable every trace of lteHelper->EnableTraces () but DlRsrpSinrStats.txt
+  static void
+  EnableLteTraces (Ptr<LteHelper> lteHelper)
+  {
+    lteHelper->EnableUlPhyTraces ();
+    lteHelper->EnableDlTxPhyTraces ();
+    lteHelper->EnableUlTxPhyTraces ();
+    lteHelper->EnableDlRxPhyTraces ();
+    lteHelper->EnableUlRxPhyTraces ();
+    lteHelper->EnableMacTraces ();
+    lteHelper->EnableRlcTraces ();
+    lteHelper->EnablePdcpTraces ();
+  }
+
+private:
+  struct UeBinding
+  {
+    DlRsrpSinrColumnarSink *sink;
+    uint64_t imsi;
+  };
+
+  static void
+  ReportCurrentCellRsrpSinr (UeBinding *ue, uint16_t cellId, uint16_t rnti, double rsrp, double sinr)
+  {
+    DlRsrpSinrColumnarSink *sink = ue->sink;
+    ColumnarTraceWriter &trace = sink->m_trace;
+    if (!trace.IsOpen ())
+      {
+        return;
+      }
+    trace.SetTime (sink->m_time, Simulator::Now ().GetNanoSeconds ());
+    trace.SetUint (sink->m_cellId, cellId);
+    trace.SetUint (sink->m_imsi, ue->imsi);
+    trace.SetUint (sink->m_rnti, rnti);
+    trace.SetFloat (sink->m_rsrp, rsrp);
+    trace.SetFloat (sink->m_sinr, sinr);
+    trace.EndRow ();
+  }
+
+  ColumnarTraceWriter m_trace;
+  std::deque<UeBinding> m_ues;      // deque: stable addresses for the bound callbacks
+  uint32_t m_time;
+  uint32_t m_cellId;
+  uint32_t m_imsi;
+  uint32_t m_rnti;
+  uint32_t m_rsrp;
+  uint32_t m_sinr;
+};
+
+} // namespace ns3
+
+#endif /* DL_RSRP_SINR_COLUMNAR_SINK_H */
@@ -0,0 +1,416 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef EVENT_PROFILER_H
+#define EVENT_PROFILER_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <typeinfo>
+#include <vector>
+#include <cxxabi.h>
+#include <stdint.h>
+
+#include "ns3/default-simulator-impl.h"
+#include "ns3/event-impl.h"
+#include "ns3/simulator.h"
+#include "ns3/simulator-impl.h"
+
+namespace ns3 {
+
+/**
+ * Count and wall time of the executed events, per event type.
+ *
+ * The type of an event is the target it was scheduled with, i.e. the
+ * arguments of the MakeEvent behind Simulator::Schedule: a member function
+ * type such as "void (LteEnbPhy::*)()" or a function type such as
+ * "void (*)(Ptr<Node>)". Member functions of one class with the same
+ * signature (LteSpectrumPhy::EndRxData and EndRxDlCtrl) share a row.
+ */
+class EventProfile
+{
+public:
+  struct Entry
+  {
+    Entry ()
+      : count (0),
+        seconds (0),
+        maxSeconds (0)
+    {
+    }
+
+    uint64_t count;
+    double seconds;
+    double maxSeconds;
+  };
+
+  struct Row
+  {
+    std::string target;
+    Entry entry;
+  };
+
+  /// The entry of an event type, valid for the life of the process
+  Entry *
+  Lookup (const std::type_info &type)
+  {
+    // The same local event class may have a type_info in every library
+    // instantiating it, rows are merged by name in GetRows
+    return &m_entries[&type];
+  }
+
+  /// One row per event target, the most expensive first
+  std::vector<Row>
+  GetRows (void) const
+  {
+    std::map<std::string, Entry> merged;
+    for (EntryMap::const_iterator it = m_entries.begin (); it != m_entries.end (); ++it)
+      {
+        if (it->second.count == 0)
+          {
+            continue;
+          }
+        Entry &entry = merged[GetTarget (*it->first)];
+        entry.count += it->second.count;
+        entry.seconds += it->second.seconds;
+        entry.maxSeconds = std::max (entry.maxSeconds, it->second.maxSeconds);
+      }
+    std::vector<Row> rows;
+    for (std::map<std::string, Entry>::const_iterator it = merged.begin (); it != merged.end (); ++it)
+      {
+        Row row;
+        row.target = it->first;
+        row.entry = it->second;
+        rows.push_back (row);
+      }
+    std::sort (rows.begin (), rows.end (), &BySeconds);
+    return rows;
+  }
+
+  /// Ranked table, at most 'top' rows (0: all)
+  void
+  Print (std::ostream &os, uint32_t top = 0) const
+  {
+    std::vector<Row> rows = GetRows ();
+    uint64_t totalCount = 0;
+    double totalSeconds = 0;
+    for (uint32_t i = 0; i < rows.size (); i++)
+      {
+        totalCount += rows[i].entry.count;
+        totalSeconds += rows[i].entry.seconds;
+      }
+    std::ios_base::fmtflags flags = os.flags ();
+    std::streamsize precision = os.precision ();
+    os << "Events: " << totalCount << " in " << std::fixed << std::setprecision (3) << totalSeconds << " s" << std::endl
+       << std::setw (5) << "rank" << std::setw (12) << "events" << std::setw (10) << "time [s]"
+       << std::setw (8) << "%" << std::setw (11) << "mean [us]" << std::setw (11) << "max [us]" << "  target" << std::endl;
+    for (uint32_t i = 0; i < rows.size () && (top == 0 || i < top); i++)
+      {
+        const Entry &e = rows[i].entry;
+        os << std::setw (5) << i + 1 << std::setw (12) << e.count
+           << std::setw (10) << std::setprecision (3) << e.seconds
+           << std::setw (8) << std::setprecision (1) << (totalSeconds > 0 ? 100 * e.seconds / totalSeconds : 0)
+           << std::setw (11) << std::setprecision (2) << 1e6 * e.seconds / e.count
+           << std::setw (11) << 1e6 * e.maxSeconds << "  " << rows[i].target << std::endl;
+      }
+    if (top > 0 && rows.size () > top)
+      {
+        os << "  ... " << rows.size () - top << " more" << std::endl;
+      }
+    os.flags (flags);
+    os.precision (precision);
+  }
+
+  /// Every row, tab separated
+  bool
+  Write (std::string filename) const
+  {
+    std::ofstream out (filename.c_str ());
+    if (!out.is_open ())
+      {
+        return false;
+      }
+    std::vector<Row> rows = GetRows ();
+    out << "% rank\tevents\tseconds\tmeanSeconds\tmaxSeconds\ttarget\n";
+    out << std::scientific << std::setprecision (6);
+    for (uint32_t i = 0; i < rows.size (); i++)
+      {
+        const Entry &e = rows[i].entry;
+        out << i + 1 << '\t' << e.count << '\t' << e.seconds << '\t' << e.seconds / e.count
+            << '\t' << e.maxSeconds << '\t' << rows[i].target << '\n';
+      }
+    return out.good ();
+  }
+
+  /**
+   * "void (LteEnbPhy::*)()" out of the event class MakeEvent defines, e.g.
+   * "ns3::MakeEvent<void (ns3::LteEnbPhy::*)(), ns3::LteEnbPhy*>(...)::EventMemberImpl0"
+   */
+  static std::string
+  GetTarget (const std::type_info &type)
+  {
+    int status = 0;
+    char *demangled = abi::__cxa_demangle (type.name (), 0, 0, &status);
+    std::string name = (status == 0 && demangled != 0) ? demangled : type.name ();
+    std::free (demangled);
+
+    std::string::size_type start = name.find ("MakeEvent<");
+    if (start != std::string::npos)
+      {
+        // First template argument: up to the first ',' or '>' outside brackets
+        start += 10;
+        int depth = 0;
+        std::string::size_type end = start;
+        for (; end < name.size (); end++)
+          {
+            char c = name[end];
+            if (c == '(' || c == '<')
+              {
+                depth++;
+              }
+            else if ((c == ')' || c == '>') && depth > 0)
+              {
+                depth--;
+              }
+            else if ((c == ',' || c == '>') && depth == 0)
+              {
+                break;
+              }
+          }
+        name = name.substr (start, end - start);
+      }
+    std::string::size_type ns;
+    while ((ns = name.find ("ns3::")) != std::string::npos)
+      {
+        name.erase (ns, 5);
+      }
+    return name;
+  }
+
+private:
+  static bool
+  BySeconds (const Row &a, const Row &b)
+  {
+    return a.entry.seconds > b.entry.seconds;
+  }
+
+  typedef std::map<const std::type_info *, Entry> EntryMap;
+  EntryMap m_entries;
+};
+
+/**
+ * A DefaultSimulatorImpl timing every event it runs. Each scheduled event
+ * is wrapped in one that invokes it between two clock reads and adds the
+ * time to the entry of its type, so the cost is an allocation and two
+ * clock reads per event: use it to find the hot spots, not to time a run.
+ *
+ * Installed with EventProfiler::Enable, before anything is scheduled.
+ */
+class ProfilingSimulatorImpl : public SimulatorImpl
+{
+public:
+  static TypeId
+  GetTypeId (void)
+  {
+    static TypeId tid = TypeId ("ns3::ProfilingSimulatorImpl")
+      .SetParent<SimulatorImpl> ()
+      .SetGroupName ("Core")
+    ;
+    return tid;
+  }
+
+  ProfilingSimulatorImpl (EventProfile *profile)
+    : m_impl (CreateObject<DefaultSimulatorImpl> ()),
+      m_profile (profile)
+  {
+  }
+
+  virtual void Destroy () { m_impl->Destroy (); }
+  virtual bool IsFinished (void) const { return m_impl->IsFinished (); }
+  virtual void Stop (void) { m_impl->Stop (); }
+  virtual void Stop (const Time &delay) { m_impl->Stop (delay); }
+
+  virtual EventId
+  Schedule (const Time &delay, EventImpl *event)
+  {
+    return m_impl->Schedule (delay, Wrap (event));
+  }
+
+  virtual void
+  ScheduleWithContext (uint32_t context, const Time &delay, EventImpl *event)
+  {
+    m_impl->ScheduleWithContext (context, delay, Wrap (event));
+  }
+
+  virtual EventId
+  ScheduleNow (EventImpl *event)
+  {
+    return m_impl->ScheduleNow (Wrap (event));
+  }
+
+  virtual EventId
+  ScheduleDestroy (EventImpl *event)
+  {
+    return m_impl->ScheduleDestroy (Wrap (event));
+  }
+
+  virtual void Remove (const EventId &id) { m_impl->Remove (id); }
+  virtual void Cancel (const EventId &id) { m_impl->Cancel (id); }
+  virtual bool IsExpired (const EventId &id) const { return m_impl->IsExpired (id); }
+  virtual void Run (void) { m_impl->Run (); }
+  virtual Time Now (void) const { return m_impl->Now (); }
+  virtual Time GetDelayLeft (const EventId &id) const { return m_impl->GetDelayLeft (id); }
+  virtual Time GetMaximumSimulationTime (void) const { return m_impl->GetMaximumSimulationTime (); }
+  virtual void SetScheduler (ObjectFactory schedulerFactory) { m_impl->SetScheduler (schedulerFactory); }
+  virtual uint32_t GetSystemId (void) const { return m_impl->GetSystemId (); }
+  virtual uint32_t GetContext (void) const { return m_impl->GetContext (); }
+  virtual uint64_t GetEventCount (void) const { return m_impl->GetEventCount (); }
+
+private:
+  typedef std::chrono::steady_clock Clock;
+
+  // Owns the scheduled event (its initial reference) and is owned by the
+  // simulator in its place; the EventId the caller gets refers to it, so
+  // cancelling works as usual
+  class ProfiledEvent : public EventImpl
+  {
+  public:
+    ProfiledEvent (EventImpl *event, EventProfile::Entry *entry)
+      : m_event (event),
+        m_entry (entry)
+    {
+    }
+
+    virtual ~ProfiledEvent ()
+    {
+      m_event->Unref ();
+    }
+
+  protected:
+    virtual void
+    Notify (void)
+    {
+      Clock::time_point start = Clock::now ();
+      m_event->Invoke ();
+      double seconds = std::chrono::duration<double> (Clock::now () - start).count ();
+      m_entry->count++;
+      m_entry->seconds += seconds;
+      m_entry->maxSeconds = std::max (m_entry->maxSeconds, seconds);
+    }
+
+  private:
+    EventImpl *m_event;
+    EventProfile::Entry *m_entry;
+  };
+
+  EventImpl *
+  Wrap (EventImpl *event)
+  {
+    return new ProfiledEvent (event, m_profile->Lookup (typeid (*event)));
+  }
+
+  virtual void
+  DoDispose (void)
+  {
+    m_impl->Dispose ();
+    m_impl = 0;
+    SimulatorImpl::DoDispose ();
+  }
+
+  Ptr<DefaultSimulatorImpl> m_impl;
+  EventProfile *m_profile;
+};
+
+/**
+ * Opt-in per event type profile of Simulator::Run ():
+ *
+ *   cmd.Parse (argc, argv);
+ *   EventProfiler::Enable (profileEvents);    // before any Simulator call
+ *   ...
+ *   Simulator::Run ();
+ *   EventProfiler::Report ("EventProfile.txt");
+ *
+ * Report prints the most expensive event types and writes all of them to
+ * the file; it does nothing unless enabled. The profiler replaces the
+ * simulator implementation, so it can't be combined with a distributed
+ * (MPI) or realtime one.
+ */
+class EventProfiler
+{
+public:
+  static void
+  Enable (bool enable)
+  {
+    if (!enable || IsEnabled ())
+      {
+        return;
+      }
+    Simulator::SetImplementation (CreateObject<ProfilingSimulatorImpl> (&GetProfile ()));
+    GetEnabled () = true;
+  }
+
+  static bool
+  IsEnabled (void)
+  {
+    return GetEnabled ();
+  }
+
+  static const EventProfile &
+  Get (void)
+  {
+    return GetProfile ();
+  }
+
+  /// Top 'top' event types on std::cout and all of them in filename
+  static void
+  Report (std::string filename, uint32_t top = 20)
+  {
+    if (!IsEnabled ())
+      {
+        return;
+      }
+    GetProfile ().Print (std::cout, top);
+    if (!GetProfile ().Write (filename))
+      {
+        std::cerr << "Can't write " << filename << std::endl;
+      }
+  }
+
+private:
+  static EventProfile &
+  GetProfile (void)
+  {
+    static EventProfile profile;
+    return profile;
+  }
+
+  static bool &
+  GetEnabled (void)
+  {
+    static bool enabled = false;
+    return enabled;
+  }
+};
+
+} // namespace ns3
+
+#endif /* EVENT_PROFILER_H */
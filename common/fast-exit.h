@@ -0,0 +1,153 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef FAST_EXIT_H
+#define FAST_EXIT_H
+
+#include <cstdio>
+#include <iostream>
+#include <vector>
+#include <unistd.h>
+
+#include "ns3/callback.h"
+#include "ns3/lte-helper.h"
+#include "ns3/radio-bearer-stats-calculator.h"
+#include "ns3/simulator.h"
+
+namespace ns3 {
+
+/**
+ * Opt-in exit without the object teardown of Simulator::Destroy.
+ *
+ * Destroying thousands of nodes, devices and applications one by one takes
+ * seconds to minutes and writes nothing. With fast exit enabled, Destroy ()
+ * only runs the registered flush hooks and Exit () leaves the process with
+ * _exit, skipping destructors as well. Anything still buffered must be
+ * written by a hook or explicitly before Exit (): trace writers with a
+ * thread (UeMeasurementRecorder, MobilitySampler, DlRsrpSinrColumnarSink)
+ * must have been stopped or closed, and AddLteStats covers the RLC/PDCP
+ * statistics, which write their last epoch on dispose. The PHY/MAC
+ * calculators of LteHelper::EnableTraces open and close their file on
+ * every record and need nothing.
+ *
+ *   FastExit::Enable (fastExit);
+ *   FastExit::AddLteStats (lteHelper);
+ *   Simulator::Run ();
+ *   ... close the trace writers, write the plots ...
+ *   FastExit::Destroy ();    // Simulator::Destroy, or the hooks only
+ *   ... last output ...
+ *   FastExit::Exit (0);      // returns unless enabled
+ *   return 0;
+ */
+class FastExit
+{
+public:
+  static void
+  Enable (bool enable)
+  {
+    GetState ().enabled = enable;
+  }
+
+  static bool
+  IsEnabled (void)
+  {
+    return GetState ().enabled;
+  }
+
+  /// Called by Destroy () in fast exit mode, in the order they were added
+  static void
+  AddFlush (Callback<void> flush)
+  {
+    GetState ().hooks.push_back (flush);
+  }
+
+  /// Write the pending RLC and PDCP statistics of lteHelper
+  static void
+  AddLteStats (Ptr<LteHelper> lteHelper)
+  {
+    AddFlush (MakeBoundCallback (&FlushLteStats, lteHelper));
+  }
+
+  /// Simulator::Destroy (), or the flush hooks when enabled
+  static void
+  Destroy (void)
+  {
+    State &state = GetState ();
+    if (!state.enabled)
+      {
+        Simulator::Destroy ();
+        return;
+      }
+    for (uint32_t i = 0; i < state.hooks.size (); i++)
+      {
+        state.hooks[i] ();
+      }
+    state.hooks.clear ();
+  }
+
+  /// When enabled, flush the standard streams and _exit (status)
+  static void
+  Exit (int status)
+  {
+    if (!GetState ().enabled)
+      {
+        return;
+      }
+    std::cout.flush ();
+    std::clog.flush ();
+    std::cerr.flush ();
+    std::fflush (0);
+    _exit (status);
+  }
+
+private:
+  struct State
+  {
+    State ()
+      : enabled (false)
+    {
+    }
+
+    bool enabled;
+    std::vector<Callback<void> > hooks;
+  };
+
+  static State &
+  GetState (void)
+  {
+    static State state;
+    return state;
+  }
+
+  static void
+  FlushLteStats (Ptr<LteHelper> lteHelper)
+  {
+    Ptr<RadioBearerStatsCalculator> rlcStats = lteHelper->GetRlcStats ();
+    if (rlcStats != 0)
+      {
+        rlcStats->Dispose ();
+      }
+    Ptr<RadioBearerStatsCalculator> pdcpStats = lteHelper->GetPdcpStats ();
+    if (pdcpStats != 0)
+      {
+        pdcpStats->Dispose ();
+      }
+  }
+};
+
+} // namespace ns3
+
+#endif /* FAST_EXIT_H */
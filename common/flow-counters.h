@@ -0,0 +1,337 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef FLOW_COUNTERS_H
+#define FLOW_COUNTERS_H
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "ns3/abort.h"
+#include "ns3/callback.h"
+#include "ns3/ipv4-flow-classifier.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/ipv4-l3-protocol.h"
+#include "ns3/node-container.h"
+#include "ns3/nstime.h"
+#include "ns3/packet.h"
+#include "ns3/simulator.h"
+#include "ns3/tag.h"
+
+namespace ns3 {
+
+/// Send time and flow of a packet sampled for delay by FlowCounters
+class FlowCountersTag : public Tag
+{
+public:
+  static TypeId
+  GetTypeId (void)
+  {
+    static TypeId tid = TypeId ("ns3::FlowCountersTag")
+      .SetParent<Tag> ()
+      .SetGroupName ("Stats")
+      .AddConstructor<FlowCountersTag> ()
+    ;
+    return tid;
+  }
+
+  FlowCountersTag ()
+    : m_txTime (0),
+      m_flow (0)
+  {
+  }
+
+  FlowCountersTag (int64_t txTime, uint32_t flow)
+    : m_txTime (txTime),
+      m_flow (flow)
+  {
+  }
+
+  virtual TypeId GetInstanceTypeId (void) const { return GetTypeId (); }
+  virtual uint32_t GetSerializedSize (void) const { return 12; }
+
+  virtual void
+  Serialize (TagBuffer buf) const
+  {
+    buf.WriteU64 (m_txTime);
+    buf.WriteU32 (m_flow);
+  }
+
+  virtual void
+  Deserialize (TagBuffer buf)
+  {
+    m_txTime = buf.ReadU64 ();
+    m_flow = buf.ReadU32 ();
+  }
+
+  virtual void
+  Print (std::ostream &os) const
+  {
+    os << "txTime=" << m_txTime << " flow=" << m_flow;
+  }
+
+  int64_t GetTxTime (void) const { return m_txTime; }
+  uint32_t GetFlow (void) const { return m_flow; }
+
+private:
+  int64_t m_txTime;
+  uint32_t m_flow;
+};
+
+/**
+ * Per-flow tx/rx bytes and packets, the subset of FlowMonitor the
+ * scenarios actually read.
+ *
+ * Only the endpoints are probed: the SendOutgoing and LocalDeliver traces
+ * of Ipv4L3Protocol on the nodes passed to Install (the traffic sources and
+ * sinks), nothing on the hops in between. Flows are keyed by their five
+ * tuple in an open addressing hash table and their counters live in flat
+ * arrays, so a packet costs one hash probe and a few increments. Packets
+ * are not tagged, except one in every 'delaySampling' packets of a flow
+ * when the delay is sampled.
+ *
+ * SerializeToXmlFile writes the FlowStats and Ipv4FlowClassifier sections
+ * of the FlowMonitor XML with the same names. delaySum is the sum over the
+ * delaySamples sampled packets only, there are no jitter, histograms or
+ * forwarding counts, and lostPackets is txPackets - rxPackets (packets in
+ * flight at the end count as lost).
+ *
+ *   FlowCounters counters (10);   // delay of one packet in 10
+ *   counters.Install (ueNodes);
+ *   counters.Install (remoteHosts);
+ *   Simulator::Run ();
+ *   counters.SerializeToXmlFile ("ThroughputMonitor.xml");
+ */
+class FlowCounters
+{
+public:
+  typedef Ipv4FlowClassifier::FiveTuple FiveTuple;
+
+  /// \param delaySampling tag one packet in that many per flow for the delay, 0 for none
+  FlowCounters (uint32_t delaySampling = 0)
+    : m_delaySampling (delaySampling),
+      m_slots (1024, 0)
+  {
+  }
+
+  void
+  Install (NodeContainer nodes)
+  {
+    for (uint32_t n = 0; n < nodes.GetN (); n++)
+      {
+        Ptr<Ipv4L3Protocol> ipv4 = nodes.Get (n)->GetObject<Ipv4L3Protocol> ();
+        NS_ABORT_MSG_IF (ipv4 == 0, "FlowCounters: node " << nodes.Get (n)->GetId () << " has no IPv4 stack");
+        ipv4->TraceConnectWithoutContext ("SendOutgoing", MakeCallback (&FlowCounters::Tx, this));
+        ipv4->TraceConnectWithoutContext ("LocalDeliver", MakeCallback (&FlowCounters::Rx, this));
+      }
+  }
+
+  /// Flows are numbered from 0 here and from 1 (flowId) in the XML
+  uint32_t GetNFlows (void) const { return m_tuples.size (); }
+  const FiveTuple &GetFiveTuple (uint32_t flow) const { return m_tuples.at (flow); }
+  uint64_t GetTxBytes (uint32_t flow) const { return m_txBytes.at (flow); }
+  uint64_t GetRxBytes (uint32_t flow) const { return m_rxBytes.at (flow); }
+  uint32_t GetTxPackets (uint32_t flow) const { return m_txPackets.at (flow); }
+  uint32_t GetRxPackets (uint32_t flow) const { return m_rxPackets.at (flow); }
+
+  void
+  SerializeToXmlFile (std::string fileName) const
+  {
+    std::ofstream os (fileName.c_str ());
+    NS_ABORT_MSG_UNLESS (os.is_open (), "FlowCounters: cannot write " << fileName);
+    os << "<?xml version=\"1.0\" ?>\n<FlowMonitor>\n  <FlowStats>\n";
+    for (uint32_t i = 0; i < m_tuples.size (); i++)
+      {
+        uint32_t lost = m_txPackets[i] > m_rxPackets[i] ? m_txPackets[i] - m_rxPackets[i] : 0;
+        os << "    <Flow flowId=\"" << i + 1 << "\""
+           << " timeFirstTxPacket=\"" << TimeStep (m_firstTx[i]) << "\""
+           << " timeFirstRxPacket=\"" << TimeStep (m_firstRx[i]) << "\""
+           << " timeLastTxPacket=\"" << TimeStep (m_lastTx[i]) << "\""
+           << " timeLastRxPacket=\"" << TimeStep (m_lastRx[i]) << "\""
+           << " delaySum=\"" << TimeStep (m_delaySum[i]) << "\""
+           << " delaySamples=\"" << m_delaySamples[i] << "\""
+           << " txBytes=\"" << m_txBytes[i] << "\""
+           << " rxBytes=\"" << m_rxBytes[i] << "\""
+           << " txPackets=\"" << m_txPackets[i] << "\""
+           << " rxPackets=\"" << m_rxPackets[i] << "\""
+           << " lostPackets=\"" << lost << "\""
+           << ">\n    </Flow>\n";
+      }
+    os << "  </FlowStats>\n  <Ipv4FlowClassifier>\n";
+    for (uint32_t i = 0; i < m_tuples.size (); i++)
+      {
+        const FiveTuple &t = m_tuples[i];
+        os << "    <Flow flowId=\"" << i + 1 << "\""
+           << " sourceAddress=\"" << t.sourceAddress << "\""
+           << " destinationAddress=\"" << t.destinationAddress << "\""
+           << " protocol=\"" << uint32_t (t.protocol) << "\""
+           << " sourcePort=\"" << t.sourcePort << "\""
+           << " destinationPort=\"" << t.destinationPort << "\""
+           << " />\n";
+      }
+    os << "  </Ipv4FlowClassifier>\n</FlowMonitor>\n";
+  }
+
+private:
+  void
+  Tx (const Ipv4Header &header, Ptr<const Packet> packet, uint32_t interface)
+  {
+    uint32_t i = Find (header, packet);
+    int64_t now = Simulator::Now ().GetTimeStep ();
+    if (m_txPackets[i] == 0)
+      {
+        m_firstTx[i] = now;
+      }
+    m_lastTx[i] = now;
+    if (m_delaySampling > 0 && m_txPackets[i] % m_delaySampling == 0)
+      {
+        // as FlowMonitor's probe does: a byte tag survives RLC segmentation
+        FlowCountersTag tag (now, i);
+        const_cast<Packet *> (PeekPointer (packet))->AddByteTag (tag);
+      }
+    m_txPackets[i]++;
+    m_txBytes[i] += packet->GetSize () + header.GetSerializedSize ();
+  }
+
+  void
+  Rx (const Ipv4Header &header, Ptr<const Packet> packet, uint32_t interface)
+  {
+    uint32_t i = Find (header, packet);
+    int64_t now = Simulator::Now ().GetTimeStep ();
+    if (m_rxPackets[i] == 0)
+      {
+        m_firstRx[i] = now;
+      }
+    m_lastRx[i] = now;
+    m_rxPackets[i]++;
+    m_rxBytes[i] += packet->GetSize () + header.GetSerializedSize ();
+    FlowCountersTag tag;
+    if (m_delaySampling > 0 && packet->FindFirstMatchingByteTag (tag) && tag.GetFlow () == i)
+      {
+        m_delaySum[i] += now - tag.GetTxTime ();
+        m_delaySamples[i]++;
+      }
+  }
+
+  // Index of the flow of the packet, added when new
+  uint32_t
+  Find (const Ipv4Header &header, Ptr<const Packet> packet)
+  {
+    FiveTuple t;
+    t.sourceAddress = header.GetSource ();
+    t.destinationAddress = header.GetDestination ();
+    t.protocol = header.GetProtocol ();
+    t.sourcePort = 0;
+    t.destinationPort = 0;
+    uint8_t ports[4];
+    if ((t.protocol == 6 || t.protocol == 17) && header.GetFragmentOffset () == 0
+        && packet->CopyData (ports, 4) == 4)
+      {
+        // TCP and UDP headers both start with the source and destination ports
+        t.sourcePort = (ports[0] << 8) | ports[1];
+        t.destinationPort = (ports[2] << 8) | ports[3];
+      }
+
+    uint32_t mask = m_slots.size () - 1;
+    uint32_t s = Hash (t) & mask;
+    for (; m_slots[s] != 0; s = (s + 1) & mask)
+      {
+        const FiveTuple &u = m_tuples[m_slots[s] - 1];
+        if (u.sourceAddress == t.sourceAddress && u.destinationAddress == t.destinationAddress
+            && u.sourcePort == t.sourcePort && u.destinationPort == t.destinationPort
+            && u.protocol == t.protocol)
+          {
+            return m_slots[s] - 1;
+          }
+      }
+
+    uint32_t i = Add (t);
+    if ((i + 1) * 2 > m_slots.size ())
+      {
+        Rehash ();
+      }
+    else
+      {
+        m_slots[s] = i + 1;
+      }
+    return i;
+  }
+
+  static uint32_t
+  Hash (const FiveTuple &t)
+  {
+    uint64_t h = (uint64_t (t.sourceAddress.Get ()) << 32 | t.destinationAddress.Get ())
+      ^ (uint64_t (t.sourcePort) << 24 | uint64_t (t.destinationPort) << 8 | t.protocol) * 0x9E3779B97F4A7C15ULL;
+    h *= 0xFF51AFD7ED558CCDULL;
+    return h >> 32;
+  }
+
+  uint32_t
+  Add (const FiveTuple &t)
+  {
+    m_tuples.push_back (t);
+    m_txBytes.push_back (0);
+    m_rxBytes.push_back (0);
+    m_txPackets.push_back (0);
+    m_rxPackets.push_back (0);
+    m_firstTx.push_back (0);
+    m_lastTx.push_back (0);
+    m_firstRx.push_back (0);
+    m_lastRx.push_back (0);
+    m_delaySum.push_back (0);
+    m_delaySamples.push_back (0);
+    return m_tuples.size () - 1;
+  }
+
+  // Doubles the table, so that it stays at most half full
+  void
+  Rehash (void)
+  {
+    m_slots.assign (m_slots.size () * 2, 0);
+    uint32_t mask = m_slots.size () - 1;
+    for (uint32_t i = 0; i < m_tuples.size (); i++)
+      {
+        uint32_t s = Hash (m_tuples[i]) & mask;
+        while (m_slots[s] != 0)
+          {
+            s = (s + 1) & mask;
+          }
+        m_slots[s] = i + 1;
+      }
+  }
+
+  uint32_t m_delaySampling;
+  std::vector<uint32_t> m_slots;      // flow index + 1, 0 when empty
+
+  // One entry per flow, times in time steps
+  std::vector<FiveTuple> m_tuples;
+  std::vector<uint64_t> m_txBytes;
+  std::vector<uint64_t> m_rxBytes;
+  std::vector<uint32_t> m_txPackets;
+  std::vector<uint32_t> m_rxPackets;
+  std::vector<int64_t> m_firstTx;
+  std::vector<int64_t> m_lastTx;
+  std::vector<int64_t> m_firstRx;
+  std::vector<int64_t> m_lastRx;
+  std::vector<int64_t> m_delaySum;
+  std::vector<uint32_t> m_delaySamples;
+};
+
+} // namespace ns3
+
+#endif /* FLOW_COUNTERS_H */
@@ -0,0 +1,424 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef HEX_GRID_TOPOLOGY_H
+#define HEX_GRID_TOPOLOGY_H
+
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ns3/abort.h"
+#include "ns3/double.h"
+#include "ns3/log.h"
+#include "ns3/lte-helper.h"
+#include "ns3/mobility-helper.h"
+#include "ns3/net-device-container.h"
+#include "ns3/node-container.h"
+#include "ns3/pointer.h"
+#include "ns3/position-allocator.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/string.h"
+#include "ns3/vector.h"
+
+namespace ns3 {
+
+/**
+ * Layout of a hexagonal multi-cell testbed, usually read from a file of
+ * "key value" lines ('#' starts a comment):
+ *
+ *   sites 19              # sites filled ring by ring around (centerX, centerY)
+ *   rings 2               # or: complete rings around the center site (1 + 3 r (r+1) sites)
+ *   site -750 0           # or: explicit site positions, one line each
+ *   cellRadius 500        # hexagon radius of a cell [m]
+ *   interSiteDistance 0   # [m], 0: sqrt(3) cellRadius with 1 sector, 3 cellRadius with 3
+ *   sectors 3             # cells per site, 1 (omni) or more (parabolic antennas)
+ *   firstSectorOrientation 30  # [deg], the others follow every 360/sectors
+ *   beamwidth 70          # [deg] of the sector antennas
+ *   maxAttenuation 20     # [dB] of the sector antennas
+ *   siteHeight 30
+ *   staticUes 2           # per cell, uniform in the cell
+ *   mobileUes 2           # per cell, random waypoint towards the cell edge
+ *   ueHeight 1.5
+ *   ueSpeed 33.36         # [m/s] of the mobile UEs
+ *   uePause 0.5           # [s] at each waypoint
+ */
+struct HexGridTopologyConfig
+{
+  HexGridTopologyConfig ()
+    : sites (1),
+      centerX (0),
+      centerY (0),
+      cellRadius (500),
+      interSiteDistance (0),
+      sectors (1),
+      firstSectorOrientation (30),
+      beamwidth (70),
+      maxAttenuation (20),
+      siteHeight (30),
+      staticUes (2),
+      mobileUes (2),
+      ueHeight (1.5),
+      ueSpeed (33.36),
+      uePause (0.5)
+  {
+  }
+
+  /// Read a configuration file, aborting on unknown keys or malformed lines
+  void
+  Load (const std::string &filename)
+  {
+    std::ifstream file (filename.c_str ());
+    NS_ABORT_MSG_UNLESS (file.is_open (), "Can't open topology file " << filename);
+    std::string line;
+    uint32_t lineNo = 0;
+    while (std::getline (file, line))
+      {
+        lineNo++;
+        line = line.substr (0, line.find ('#'));
+        std::istringstream iss (line);
+        std::string key;
+        if (!(iss >> key))
+          {
+            continue;
+          }
+        bool ok = true;
+        if (key == "site")
+          {
+            Vector site;
+            ok = bool (iss >> site.x >> site.y);
+            explicitSites.push_back (site);
+          }
+        else if (key == "rings")
+          {
+            uint32_t rings;
+            ok = bool (iss >> rings);
+            sites = 1 + 3 * rings * (rings + 1);
+          }
+        else if (key == "sites") { ok = bool (iss >> sites); }
+        else if (key == "centerX") { ok = bool (iss >> centerX); }
+        else if (key == "centerY") { ok = bool (iss >> centerY); }
+        else if (key == "cellRadius") { ok = bool (iss >> cellRadius); }
+        else if (key == "interSiteDistance") { ok = bool (iss >> interSiteDistance); }
+        else if (key == "sectors") { ok = bool (iss >> sectors) && sectors > 0; }
+        else if (key == "firstSectorOrientation") { ok = bool (iss >> firstSectorOrientation); }
+        else if (key == "beamwidth") { ok = bool (iss >> beamwidth); }
+        else if (key == "maxAttenuation") { ok = bool (iss >> maxAttenuation); }
+        else if (key == "siteHeight") { ok = bool (iss >> siteHeight); }
+        else if (key == "staticUes") { ok = bool (iss >> staticUes); }
+        else if (key == "mobileUes") { ok = bool (iss >> mobileUes); }
+        else if (key == "ueHeight") { ok = bool (iss >> ueHeight); }
+        else if (key == "ueSpeed") { ok = bool (iss >> ueSpeed); }
+        else if (key == "uePause") { ok = bool (iss >> uePause); }
+        else
+          {
+            NS_ABORT_MSG (filename << ":" << lineNo << ": unknown key " << key);
+          }
+        NS_ABORT_MSG_UNLESS (ok, filename << ":" << lineNo << ": bad value for " << key);
+      }
+  }
+
+  uint32_t
+  GetNSites (void) const
+  {
+    return explicitSites.empty () ? sites : explicitSites.size ();
+  }
+
+  uint32_t
+  GetNCells (void) const
+  {
+    return GetNSites () * sectors;
+  }
+
+  double
+  GetInterSiteDistance (void) const
+  {
+    if (interSiteDistance > 0)
+      {
+        return interSiteDistance;
+      }
+    return sectors == 1 ? std::sqrt (3.0) * cellRadius : 3.0 * cellRadius;
+  }
+
+  /// Site positions (z = 0), explicit ones or ring by ring around the center
+  std::vector<Vector>
+  GetSitePositions (void) const
+  {
+    if (!explicitSites.empty ())
+      {
+        return explicitSites;
+      }
+    // Neighbouring sites are one inter-site distance away at 30 + 60 k degrees
+    double d = GetInterSiteDistance ();
+    Vector dirs[6];
+    for (uint32_t i = 0; i < 6; i++)
+      {
+        double angle = (30.0 + 60.0 * i) * M_PI / 180.0;
+        dirs[i] = Vector (d * std::cos (angle), d * std::sin (angle), 0);
+      }
+    std::vector<Vector> positions (1, Vector (centerX, centerY, 0));
+    for (uint32_t ring = 1; positions.size () < sites; ring++)
+      {
+        Vector pos (centerX + ring * dirs[4].x, centerY + ring * dirs[4].y, 0);
+        for (uint32_t side = 0; side < 6; side++)
+          {
+            for (uint32_t step = 0; step < ring && positions.size () < sites; step++)
+              {
+                positions.push_back (pos);
+                pos.x += dirs[side].x;
+                pos.y += dirs[side].y;
+              }
+          }
+      }
+    return positions;
+  }
+
+  uint32_t sites;
+  double centerX;
+  double centerY;
+  double cellRadius;
+  double interSiteDistance;
+  uint32_t sectors;
+  double firstSectorOrientation;
+  double beamwidth;
+  double maxAttenuation;
+  double siteHeight;
+  uint32_t staticUes;
+  uint32_t mobileUes;
+  double ueHeight;
+  double ueSpeed;
+  double uePause;
+  std::vector<Vector> explicitSites;
+};
+
+/**
+ * Builds the nodes, mobility and LTE devices of a HexGridTopologyConfig.
+ *
+ * Cell i is sector (i % sectors) of site (i / sectors). UEs are created and
+ * installed cell after cell, static ones first, so the IMSIs of cell i are
+ * i * uesPerCell + 1 ... (i + 1) * uesPerCell. Devices are installed with one
+ * InstallEnbDevice call per sector orientation and a single InstallUeDevice.
+ *
+ *   HexGridTopologyBuilder topology (config);
+ *   topology.CreateNodes ();
+ *   internet.Install (topology.GetUeNodes ());
+ *   topology.InstallDevices (lteHelper);
+ *   ... assign IPs and routes ...
+ *   topology.Attach (lteHelper);
+ */
+class HexGridTopologyBuilder
+{
+public:
+  HexGridTopologyBuilder (const HexGridTopologyConfig &config)
+    : m_config (config)
+  {
+  }
+
+  /// Create the eNB and UE nodes with their mobility models
+  void
+  CreateNodes (void)
+  {
+    const HexGridTopologyConfig &c = m_config;
+    std::vector<Vector> sites = c.GetSitePositions ();
+    uint32_t nCells = c.GetNCells ();
+
+    m_enbNodes.Create (nCells);
+    Ptr<ListPositionAllocator> enbPositions = CreateObject<ListPositionAllocator> ();
+    for (uint32_t cell = 0; cell < nCells; cell++)
+      {
+        const Vector &site = sites[cell / c.sectors];
+        double orientation = GetOrientation (cell);
+        double offset = c.sectors > 1 ? 0.5 : 0.0;    // keeps the sectors of a site apart
+        enbPositions->Add (Vector (site.x + offset * std::cos (orientation * M_PI / 180.0),
+                                   site.y + offset * std::sin (orientation * M_PI / 180.0),
+                                   c.siteHeight));
+        // Sector cells serve the hexagon in front of the antenna
+        double shift = c.sectors > 1 ? c.cellRadius : 0.0;
+        m_cellCenters.push_back (Vector (site.x + shift * std::cos (orientation * M_PI / 180.0),
+                                         site.y + shift * std::sin (orientation * M_PI / 180.0),
+                                         0));
+      }
+    MobilityHelper enbMobility;
+    enbMobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+    enbMobility.SetPositionAllocator (enbPositions);
+    enbMobility.Install (m_enbNodes);
+
+    // 0.866 R keeps the UEs inside the hexagon
+    Ptr<UniformRandomVariable> waypointRadius = CreateObject<UniformRandomVariable> ();
+    waypointRadius->SetAttribute ("Min", DoubleValue (0.800 * c.cellRadius));
+    waypointRadius->SetAttribute ("Max", DoubleValue (0.866 * c.cellRadius));
+    std::ostringstream speed;
+    speed << "ns3::ConstantRandomVariable[Constant=" << c.ueSpeed << "]";
+    std::ostringstream pause;
+    pause << "ns3::ConstantRandomVariable[Constant=" << c.uePause << "]";
+
+    for (uint32_t cell = 0; cell < nCells; cell++)
+      {
+        const Vector &center = m_cellCenters[cell];
+        NodeContainer staticUes;
+        staticUes.Create (c.staticUes);
+        NodeContainer mobileUes;
+        mobileUes.Create (c.mobileUes);
+
+        Ptr<UniformDiscPositionAllocator> disc = CreateObject<UniformDiscPositionAllocator> ();
+        disc->SetX (center.x);
+        disc->SetY (center.y);
+        disc->SetRho (0.866 * c.cellRadius);
+        Ptr<ListPositionAllocator> staticPositions = CreateObject<ListPositionAllocator> ();
+        for (uint32_t u = 0; u < c.staticUes; u++)
+          {
+            Vector pos = disc->GetNext ();
+            pos.z = c.ueHeight;
+            staticPositions->Add (pos);
+          }
+        MobilityHelper staticMobility;
+        staticMobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+        staticMobility.SetPositionAllocator (staticPositions);
+        staticMobility.Install (staticUes);
+
+        // Mobile UEs start next to the cell center and wander towards its edge
+        Ptr<ListPositionAllocator> mobileStart = CreateObject<ListPositionAllocator> ();
+        for (uint32_t u = 0; u < c.mobileUes; u++)
+          {
+            mobileStart->Add (Vector (center.x + 50, center.y + 50, c.ueHeight));
+          }
+        Ptr<RandomDiscPositionAllocator> waypoints = CreateObject<RandomDiscPositionAllocator> ();
+        waypoints->SetX (center.x);
+        waypoints->SetY (center.y);
+        waypoints->SetRho (waypointRadius);
+        MobilityHelper mobileMobility;
+        mobileMobility.SetMobilityModel ("ns3::RandomWaypointMobilityModel",
+                                         "Speed", StringValue (speed.str ()),
+                                         "Pause", StringValue (pause.str ()),
+                                         "PositionAllocator", PointerValue (waypoints));
+        mobileMobility.SetPositionAllocator (mobileStart);
+        mobileMobility.Install (mobileUes);
+
+        m_cellStaticUes.push_back (staticUes);
+        m_cellMobileUes.push_back (mobileUes);
+        m_cellUes.push_back (NodeContainer (staticUes, mobileUes));
+        m_ueNodes.Add (m_cellUes.back ());
+        m_staticUeNodes.Add (staticUes);
+        m_mobileUeNodes.Add (mobileUes);
+      }
+  }
+
+  /// Install the eNB and UE devices, in bulk
+  void
+  InstallDevices (Ptr<LteHelper> lteHelper)
+  {
+    const HexGridTopologyConfig &c = m_config;
+    std::vector<Ptr<NetDevice> > enbDevs (c.GetNCells ());
+    if (c.sectors > 1)
+      {
+        lteHelper->SetEnbAntennaModelType ("ns3::ParabolicAntennaModel");
+        lteHelper->SetEnbAntennaModelAttribute ("Beamwidth", DoubleValue (c.beamwidth));
+        lteHelper->SetEnbAntennaModelAttribute ("MaxAttenuation", DoubleValue (c.maxAttenuation));
+      }
+    for (uint32_t sector = 0; sector < c.sectors; sector++)
+      {
+        NodeContainer sectorNodes;
+        for (uint32_t cell = sector; cell < c.GetNCells (); cell += c.sectors)
+          {
+            sectorNodes.Add (m_enbNodes.Get (cell));
+          }
+        if (c.sectors > 1)
+          {
+            lteHelper->SetEnbAntennaModelAttribute ("Orientation", DoubleValue (GetOrientation (sector)));
+          }
+        NetDeviceContainer devs = lteHelper->InstallEnbDevice (sectorNodes);
+        for (uint32_t i = 0; i < devs.GetN (); i++)
+          {
+            enbDevs[sector + i * c.sectors] = devs.Get (i);
+          }
+      }
+    for (uint32_t cell = 0; cell < enbDevs.size (); cell++)
+      {
+        m_enbDevs.Add (enbDevs[cell]);
+      }
+
+    m_ueDevs = lteHelper->InstallUeDevice (m_ueNodes);
+    uint32_t uesPerCell = c.staticUes + c.mobileUes;
+    for (uint32_t cell = 0; cell < c.GetNCells (); cell++)
+      {
+        NetDeviceContainer cellDevs;
+        for (uint32_t u = 0; u < uesPerCell; u++)
+          {
+            cellDevs.Add (m_ueDevs.Get (cell * uesPerCell + u));
+          }
+        m_cellUeDevs.push_back (cellDevs);
+      }
+  }
+
+  /// Attach the UEs of every cell to its eNB
+  void
+  Attach (Ptr<LteHelper> lteHelper)
+  {
+    for (uint32_t cell = 0; cell < m_cellUeDevs.size (); cell++)
+      {
+        lteHelper->Attach (m_cellUeDevs[cell], m_enbDevs.Get (cell));
+      }
+  }
+
+  const HexGridTopologyConfig & GetConfig (void) const { return m_config; }
+  uint32_t GetNCells (void) const { return m_config.GetNCells (); }
+  Vector GetCellCenter (uint32_t cell) const { return m_cellCenters[cell]; }
+
+  /// Sector orientation of a cell, in degrees
+  double
+  GetOrientation (uint32_t cell) const
+  {
+    return m_config.firstSectorOrientation + (cell % m_config.sectors) * 360.0 / m_config.sectors;
+  }
+
+  /// Cell ID a fresh LteHelper gives to a cell, the eNBs are installed sector by sector
+  uint16_t
+  GetCellId (uint32_t cell) const
+  {
+    return (cell % m_config.sectors) * m_config.GetNSites () + cell / m_config.sectors + 1;
+  }
+
+  NodeContainer GetEnbNodes (void) const { return m_enbNodes; }
+  NodeContainer GetUeNodes (void) const { return m_ueNodes; }
+  NodeContainer GetStaticUeNodes (void) const { return m_staticUeNodes; }
+  NodeContainer GetMobileUeNodes (void) const { return m_mobileUeNodes; }
+  NodeContainer GetCellUeNodes (uint32_t cell) const { return m_cellUes[cell]; }
+  NodeContainer GetCellStaticUeNodes (uint32_t cell) const { return m_cellStaticUes[cell]; }
+  NodeContainer GetCellMobileUeNodes (uint32_t cell) const { return m_cellMobileUes[cell]; }
+  NetDeviceContainer GetEnbDevices (void) const { return m_enbDevs; }
+  NetDeviceContainer GetUeDevices (void) const { return m_ueDevs; }
+  NetDeviceContainer GetCellUeDevices (uint32_t cell) const { return m_cellUeDevs[cell]; }
+
+private:
+  HexGridTopologyConfig m_config;
+  std::vector<Vector> m_cellCenters;
+  NodeContainer m_enbNodes;
+  NodeContainer m_ueNodes;
+  NodeContainer m_staticUeNodes;
+  NodeContainer m_mobileUeNodes;
+  std::vector<NodeContainer> m_cellUes;
+  std::vector<NodeContainer> m_cellStaticUes;
+  std::vector<NodeContainer> m_cellMobileUes;
+  NetDeviceContainer m_enbDevs;
+  NetDeviceContainer m_ueDevs;
+  std::vector<NetDeviceContainer> m_cellUeDevs;
+};
+
+} // namespace ns3
+
+#endif /* HEX_GRID_TOPOLOGY_H */
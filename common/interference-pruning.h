@@ -0,0 +1,193 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef INTERFERENCE_PRUNING_H
+#define INTERFERENCE_PRUNING_H
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <stdint.h>
+
+#include "ns3/abort.h"
+#include "ns3/callback.h"
+#include "ns3/double.h"
+#include "ns3/lte-enb-net-device.h"
+#include "ns3/lte-enb-phy.h"
+#include "ns3/lte-helper.h"
+#include "ns3/lte-ue-net-device.h"
+#include "ns3/lte-ue-phy.h"
+#include "ns3/net-device-container.h"
+#include "ns3/spectrum-channel.h"
+#include "ns3/spectrum-phy.h"
+
+#include "phase-timer.h"
+
+namespace ns3 {
+
+/**
+ * Drops the LTE transmissions that reach a receiver more than a margin
+ * below its noise floor, instead of delivering every transmission to every
+ * PHY on the channel.
+ *
+ * The pruning itself is the MaxLossDb attribute of the spectrum channel:
+ * a signal whose pathloss (antenna gains included, fading excluded) is
+ * larger than that is not passed to the receiver at all, so it neither
+ * adds to the interference nor costs a StartRx. The threshold of each
+ * direction is
+ *
+ *   maxLoss = txPower per RB - (kT + 10 log10 (180 kHz) + NF) + margin
+ *
+ * with the highest TX power and the lowest noise figure of the devices
+ * (an eNB spreads its power over the DL bandwidth, a UE may put all of it
+ * on one RB). The PathLoss trace of the channels counts the deliveries
+ * and the skipped ones, to check what the pruning throws away; note that
+ * a skipped cell is also missing from the RSRP/RSRQ measurements of the UE.
+ *
+ *   InterferencePruning pruning;
+ *   pruning.Enable (lteHelper, enbDevs, ueDevs, 10);   // 10 dB below the noise
+ *   Simulator::Run ();
+ *   pruning.Print (std::cout);
+ */
+class InterferencePruning
+{
+public:
+  InterferencePruning ()
+    : m_enabled (false)
+  {
+    for (uint32_t d = 0; d < 2; d++)
+      {
+        m_maxLossDb[d] = 0;
+        m_delivered[d] = 0;
+        m_skipped[d] = 0;
+      }
+  }
+
+  /// Max pathloss to a receiver with noiseFigureDb for txPowerDbm over nRbs RBs
+  static double
+  GetMaxLossDb (double txPowerDbm, uint32_t nRbs, double noiseFigureDb, double marginDb)
+  {
+    double noisePerRbDbm = -174.0 + 10 * std::log10 (180e3) + noiseFigureDb;
+    return txPowerDbm - 10 * std::log10 (double (nRbs)) - noisePerRbDbm + marginDb;
+  }
+
+  /// Call once the devices are installed, the channels exist from then on
+  void
+  Enable (Ptr<LteHelper> lteHelper, NetDeviceContainer enbDevs, NetDeviceContainer ueDevs, double marginDb)
+  {
+    NS_ABORT_MSG_IF (enbDevs.GetN () == 0 || ueDevs.GetN () == 0, "InterferencePruning: no devices");
+    double enbTxPowerDbm = -1e9, enbNoiseFigureDb = 1e9;
+    uint32_t dlRbs = 1000;
+    for (uint32_t i = 0; i < enbDevs.GetN (); i++)
+      {
+        Ptr<LteEnbNetDevice> dev = enbDevs.Get (i)->GetObject<LteEnbNetDevice> ();
+        enbTxPowerDbm = std::max (enbTxPowerDbm, dev->GetPhy ()->GetTxPower ());
+        enbNoiseFigureDb = std::min (enbNoiseFigureDb, GetDouble (dev->GetPhy (), "NoiseFigure"));
+        dlRbs = std::min (dlRbs, uint32_t (dev->GetDlBandwidth ()));
+      }
+    double ueTxPowerDbm = -1e9, ueNoiseFigureDb = 1e9;
+    for (uint32_t i = 0; i < ueDevs.GetN (); i++)
+      {
+        Ptr<LteUeNetDevice> dev = ueDevs.Get (i)->GetObject<LteUeNetDevice> ();
+        ueTxPowerDbm = std::max (ueTxPowerDbm, dev->GetPhy ()->GetTxPower ());
+        ueNoiseFigureDb = std::min (ueNoiseFigureDb, GetDouble (dev->GetPhy (), "NoiseFigure"));
+      }
+
+    m_maxLossDb[DL] = GetMaxLossDb (enbTxPowerDbm, dlRbs, ueNoiseFigureDb, marginDb);
+    m_maxLossDb[UL] = GetMaxLossDb (ueTxPowerDbm, 1, enbNoiseFigureDb, marginDb);
+    Prune (lteHelper->GetDownlinkSpectrumChannel (), DL);
+    Prune (lteHelper->GetUplinkSpectrumChannel (), UL);
+    m_enabled = true;
+  }
+
+  bool IsEnabled (void) const { return m_enabled; }
+
+  void
+  Print (std::ostream &os) const
+  {
+    if (!m_enabled)
+      {
+        return;
+      }
+    const char *names[2] = { "DL", "UL" };
+    for (uint32_t d = 0; d < 2; d++)
+      {
+        uint64_t total = m_delivered[d] + m_skipped[d];
+        os << "Interference pruning " << names[d] << ": max loss " << m_maxLossDb[d] << " dB, "
+           << m_delivered[d] << " delivered, " << m_skipped[d] << " skipped ("
+           << (total > 0 ? 100.0 * m_skipped[d] / total : 0) << "%)" << std::endl;
+      }
+  }
+
+  /// pruned_dl_skipped, pruned_dl_delivered, ... in PhaseTimes.json
+  void
+  SetValues (PhaseTimer &timer) const
+  {
+    if (m_enabled)
+      {
+        timer.SetValue ("pruned_dl_delivered", m_delivered[DL]);
+        timer.SetValue ("pruned_dl_skipped", m_skipped[DL]);
+        timer.SetValue ("pruned_ul_delivered", m_delivered[UL]);
+        timer.SetValue ("pruned_ul_skipped", m_skipped[UL]);
+      }
+  }
+
+private:
+  enum Direction
+  {
+    DL = 0,
+    UL = 1
+  };
+
+  static double
+  GetDouble (Ptr<Object> object, std::string name)
+  {
+    DoubleValue value;
+    object->GetAttribute (name, value);
+    return value.Get ();
+  }
+
+  void
+  Prune (Ptr<SpectrumChannel> channel, Direction d)
+  {
+    NS_ABORT_MSG_IF (channel == 0, "InterferencePruning: the LTE channels are not created yet");
+    channel->SetAttribute ("MaxLossDb", DoubleValue (m_maxLossDb[d]));
+    channel->TraceConnectWithoutContext ("PathLoss", MakeCallback (d == DL ? &InterferencePruning::CountDl
+                                                                            : &InterferencePruning::CountUl, this));
+  }
+
+  void
+  CountDl (Ptr<SpectrumPhy> txPhy, Ptr<SpectrumPhy> rxPhy, double lossDb)
+  {
+    (lossDb > m_maxLossDb[DL] ? m_skipped[DL] : m_delivered[DL])++;
+  }
+
+  void
+  CountUl (Ptr<SpectrumPhy> txPhy, Ptr<SpectrumPhy> rxPhy, double lossDb)
+  {
+    (lossDb > m_maxLossDb[UL] ? m_skipped[UL] : m_delivered[UL])++;
+  }
+
+  bool m_enabled;
+  double m_maxLossDb[2];
+  uint64_t m_delivered[2];
+  uint64_t m_skipped[2];
+};
+
+} // namespace ns3
+
+#endif /* INTERFERENCE_PRUNING_H */
@@ -0,0 +1,88 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef ISOLATED_RUN_H
+#define ISOLATED_RUN_H
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include <fcntl.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "ns3/fatal-error.h"
+
+namespace ns3 {
+
+/**
+ * Start the program args[0] with the arguments args[1..] as a child process
+ * running in 'dir', with its stdout and stderr in dir/console.txt, and
+ * return its pid for waitpid/wait4. Used by the drivers that run scenarios
+ * as isolated processes (LteSweep, LteBenchmark).
+ *
+ * With a timeout the child gets SIGALRM after that many wall seconds, which
+ * ends it unless the program handles the signal: WTERMSIG (status) ==
+ * SIGALRM. A child that can't enter 'dir' exits with 126, one whose exec
+ * fails with 127.
+ */
+inline pid_t
+StartIsolatedRun (const std::string &dir, const std::vector<std::string> &args, uint32_t timeout)
+{
+  pid_t pid = fork ();
+  if (pid < 0)
+    {
+      NS_FATAL_ERROR ("fork failed: " << std::strerror (errno));
+    }
+  if (pid > 0)
+    {
+      return pid;
+    }
+
+  // Child: isolate the run in its own directory and keep its console output there
+  if (chdir (dir.c_str ()) != 0)
+    {
+      _exit (126);
+    }
+  int fd = open ("console.txt", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd >= 0)
+    {
+      dup2 (fd, STDOUT_FILENO);
+      dup2 (fd, STDERR_FILENO);
+      close (fd);
+    }
+  if (timeout > 0)
+    {
+      alarm (timeout);    // survives execv, SIGALRM ends the run
+    }
+  std::vector<char *> argv;
+  for (uint32_t i = 0; i < args.size (); i++)
+    {
+      argv.push_back (const_cast<char *> (args[i].c_str ()));
+    }
+  argv.push_back (0);
+  execv (args[0].c_str (), &argv[0]);
+  std::cerr << "execv " << args[0] << " failed: " << std::strerror (errno) << std::endl;
+  _exit (127);
+}
+
+} // namespace ns3
+
+#endif /* ISOLATED_RUN_H */
@@ -0,0 +1,238 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef LTE_DEVICE_REGISTRY_H
+#define LTE_DEVICE_REGISTRY_H
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "ns3/abort.h"
+#include "ns3/callback.h"
+#include "ns3/log.h"
+#include "ns3/lte-enb-net-device.h"
+#include "ns3/lte-ue-net-device.h"
+#include "ns3/lte-ue-rrc.h"
+#include "ns3/mobility-model.h"
+#include "ns3/net-device-container.h"
+#include "ns3/node.h"
+
+namespace ns3 {
+
+/**
+ * The LTE devices of a scenario in two arrays, filled when the devices are
+ * installed, so reports and trace sinks walk an array instead of NodeList
+ * and a GetObject per device.
+ *
+ * A UE is found by IMSI or by (cellId, RNTI) in constant time: IMSIs and
+ * cell IDs are small integers handed out in order by LteHelper, so both index
+ * plain vectors. The serving cell and RNTI of a UE follow the
+ * ConnectionEstablished and HandoverEndOk traces of its RRC, which the
+ * registry connects to; it has to outlive the simulation. Entry pointers are
+ * valid until the next Add.
+ *
+ *   LteDeviceRegistry registry;
+ *   registry.AddEnbDevices (lteHelper->InstallEnbDevice (enbNodes));
+ *   registry.AddUeDevices (lteHelper->InstallUeDevice (ueNodes));
+ *   ...
+ *   const LteDeviceRegistry::UeEntry *ue = registry.FindUe (cellId, rnti);
+ */
+class LteDeviceRegistry
+{
+public:
+  struct UeEntry
+  {
+    Ptr<LteUeNetDevice> device;
+    Ptr<MobilityModel> mobility;
+    uint64_t imsi;
+    uint16_t cellId;      ///< serving cell, 0 until the RRC connection
+    uint16_t rnti;        ///< 0 until the RRC connection
+  };
+
+  struct EnbEntry
+  {
+    Ptr<LteEnbNetDevice> device;
+    Ptr<MobilityModel> mobility;
+    uint16_t cellId;
+  };
+
+  LteDeviceRegistry ()
+  {
+  }
+
+  void
+  AddEnbDevices (NetDeviceContainer enbDevs)
+  {
+    for (NetDeviceContainer::Iterator it = enbDevs.Begin (); it != enbDevs.End (); ++it)
+      {
+        EnbEntry enb;
+        enb.device = (*it)->GetObject<LteEnbNetDevice> ();
+        NS_ABORT_MSG_IF (enb.device == 0, "LteDeviceRegistry: not an LTE eNB device");
+        enb.mobility = (*it)->GetNode ()->GetObject<MobilityModel> ();
+        enb.cellId = enb.device->GetCellId ();
+        SetIndex (m_enbByCellId, enb.cellId, m_enbs.size ());
+        m_enbs.push_back (enb);
+      }
+  }
+
+  void
+  AddUeDevices (NetDeviceContainer ueDevs)
+  {
+    for (NetDeviceContainer::Iterator it = ueDevs.Begin (); it != ueDevs.End (); ++it)
+      {
+        UeEntry ue;
+        ue.device = (*it)->GetObject<LteUeNetDevice> ();
+        NS_ABORT_MSG_IF (ue.device == 0, "LteDeviceRegistry: not an LTE UE device");
+        ue.mobility = (*it)->GetNode ()->GetObject<MobilityModel> ();
+        ue.imsi = ue.device->GetImsi ();
+        ue.cellId = 0;
+        ue.rnti = 0;
+        SetIndex (m_ueByImsi, ue.imsi, m_ues.size ());
+        m_ues.push_back (ue);
+
+        Ptr<LteUeRrc> rrc = ue.device->GetRrc ();
+        rrc->TraceConnectWithoutContext ("ConnectionEstablished", MakeCallback (&LteDeviceRegistry::UpdateRnti, this));
+        rrc->TraceConnectWithoutContext ("HandoverEndOk", MakeCallback (&LteDeviceRegistry::UpdateRnti, this));
+      }
+  }
+
+  uint32_t GetNUes (void) const { return m_ues.size (); }
+  uint32_t GetNEnbs (void) const { return m_enbs.size (); }
+  const UeEntry & GetUe (uint32_t i) const { return m_ues[i]; }
+  const EnbEntry & GetEnb (uint32_t i) const { return m_enbs[i]; }
+
+  /// The UE with this IMSI, 0 if there is none
+  const UeEntry *
+  FindUe (uint64_t imsi) const
+  {
+    uint32_t i = GetIndex (m_ueByImsi, imsi);
+    return i == NONE ? 0 : &m_ues[i];
+  }
+
+  /// The UE connected to cellId with this RNTI, 0 if there is none
+  const UeEntry *
+  FindUe (uint16_t cellId, uint16_t rnti) const
+  {
+    if (cellId >= m_ueByCellRnti.size ())
+      {
+        return 0;
+      }
+    uint32_t i = GetIndex (m_ueByCellRnti[cellId], rnti);
+    return i == NONE ? 0 : &m_ues[i];
+  }
+
+  /// The eNB of cellId, 0 if there is none
+  const EnbEntry *
+  FindEnb (uint16_t cellId) const
+  {
+    uint32_t i = GetIndex (m_enbByCellId, cellId);
+    return i == NONE ? 0 : &m_enbs[i];
+  }
+
+  /// gnuplot labels of the UEs (IMSI) at their current position
+  void
+  PrintGnuplottableUeListToFile (std::string filename) const
+  {
+    std::ofstream outFile (filename.c_str (), std::ios_base::out | std::ios_base::trunc);
+    if (!outFile.is_open ())
+      {
+        NS_LOG_UNCOND ("Can't open file " << filename);
+        return;
+      }
+    for (uint32_t i = 0; i < m_ues.size (); i++)
+      {
+        Vector pos = m_ues[i].mobility->GetPosition ();
+        outFile << "set label \"" << m_ues[i].imsi
+                << "\" at " << pos.x << "," << pos.y
+                << " left font \"Helvetica,4\" textcolor rgb \"grey\" front point pt 1 ps 0.3 lc rgb \"grey\" offset 0,0"
+                << std::endl;
+      }
+  }
+
+  /// gnuplot labels of the eNBs (cell ID)
+  void
+  PrintGnuplottableEnbListToFile (std::string filename) const
+  {
+    std::ofstream outFile (filename.c_str (), std::ios_base::out | std::ios_base::trunc);
+    if (!outFile.is_open ())
+      {
+        NS_LOG_UNCOND ("Can't open file " << filename);
+        return;
+      }
+    for (uint32_t i = 0; i < m_enbs.size (); i++)
+      {
+        Vector pos = m_enbs[i].mobility->GetPosition ();
+        outFile << "set label \"" << m_enbs[i].cellId
+                << "\" at " << pos.x << "," << pos.y
+                << " left font \"Helvetica,4\" textcolor rgb \"white\" front  point pt 2 ps 0.3 lc rgb \"white\" offset 0,0"
+                << std::endl;
+      }
+  }
+
+private:
+  static const uint32_t NONE = 0xffffffff;
+
+  // The trace callbacks are bound to this
+  LteDeviceRegistry (const LteDeviceRegistry &);
+  LteDeviceRegistry & operator= (const LteDeviceRegistry &);
+
+  static void
+  SetIndex (std::vector<uint32_t> &index, uint64_t key, uint32_t value)
+  {
+    if (key >= index.size ())
+      {
+        index.resize (key + 1, uint32_t (NONE));
+      }
+    index[key] = value;
+  }
+
+  static uint32_t
+  GetIndex (const std::vector<uint32_t> &index, uint64_t key)
+  {
+    return key < index.size () ? index[key] : uint32_t (NONE);
+  }
+
+  void
+  UpdateRnti (uint64_t imsi, uint16_t cellId, uint16_t rnti)
+  {
+    uint32_t i = GetIndex (m_ueByImsi, imsi);
+    NS_ASSERT_MSG (i != NONE, "LteDeviceRegistry: unknown IMSI " << imsi);
+    UeEntry &ue = m_ues[i];
+    if (ue.cellId < m_ueByCellRnti.size () && GetIndex (m_ueByCellRnti[ue.cellId], ue.rnti) == i)
+      {
+        m_ueByCellRnti[ue.cellId][ue.rnti] = NONE;     // left its previous cell
+      }
+    ue.cellId = cellId;
+    ue.rnti = rnti;
+    if (cellId >= m_ueByCellRnti.size ())
+      {
+        m_ueByCellRnti.resize (cellId + 1);
+      }
+    SetIndex (m_ueByCellRnti[cellId], rnti, i);
+  }
+
+  std::vector<UeEntry> m_ues;
+  std::vector<EnbEntry> m_enbs;
+  std::vector<uint32_t> m_ueByImsi;
+  std::vector<uint32_t> m_enbByCellId;
+  std::vector<std::vector<uint32_t> > m_ueByCellRnti;   // [cellId][rnti]
+};
+
+} // namespace ns3
+
+#endif /* LTE_DEVICE_REGISTRY_H */
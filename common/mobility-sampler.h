@@ -0,0 +1,214 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef MOBILITY_SAMPLER_H
+#define MOBILITY_SAMPLER_H
+
+/*
+ * Snapshots of the position and velocity of a set of nodes, taken by one
+ * periodic event and written in batches.
+ *
+ * CSV: a "time,ue,node,x,y,z,vx,vy,vz" header and one line per node and
+ * tick, ue being the index of the node in the sampled set.
+ *
+ * Binary (little-endian): magic "MOBTRACE" (8 bytes), version (uint32),
+ * number of nodes N (uint32), their node ids (N x uint32), then per tick the
+ * time in seconds (double) followed by x, y, z, vx, vy, vz of every node
+ * (N x 6 doubles).
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "ns3/event-id.h"
+#include "ns3/mobility-model.h"
+#include "ns3/node-container.h"
+#include "ns3/nstime.h"
+#include "ns3/simulator.h"
+
+#include "async-block-writer.h"
+
+namespace ns3 {
+
+class MobilitySampler
+{
+public:
+  enum Format
+  {
+    CSV,
+    BINARY
+  };
+
+  MobilitySampler ()
+    : m_format (CSV),
+      m_ticksPerFlush (16),
+      m_ticks (0),
+      m_running (false)
+  {
+  }
+
+  ~MobilitySampler ()
+  {
+    Stop ();
+  }
+
+  /// Add nodes (with a MobilityModel) to the sampled set, before Open ()
+  void
+  Add (NodeContainer nodes)
+  {
+    for (NodeContainer::Iterator it = nodes.Begin (); it != nodes.End (); ++it)
+      {
+        Ptr<MobilityModel> mobility = (*it)->GetObject<MobilityModel> ();
+        NS_ASSERT_MSG (mobility != 0, "Node " << (*it)->GetId () << " has no mobility model");
+        m_models.push_back (mobility);
+        m_nodeIds.push_back ((*it)->GetId ());
+      }
+  }
+
+  /**
+   * \param filename output file
+   * \param format CSV or BINARY
+   * \param ticksPerFlush snapshots buffered before a write
+   * \return false if the file can't be created
+   */
+  bool
+  Open (const std::string &filename, Format format = CSV, uint32_t ticksPerFlush = 16)
+  {
+    if (!m_writer.Open (filename))
+      {
+        return false;
+      }
+    m_format = format;
+    m_ticksPerFlush = ticksPerFlush > 0 ? ticksPerFlush : 1;
+    m_ticks = 0;
+    m_block.clear ();
+    if (m_format == CSV)
+      {
+        const char header[] = "time,ue,node,x,y,z,vx,vy,vz\n";
+        m_block.insert (m_block.end (), header, header + sizeof (header) - 1);
+      }
+    else
+      {
+        uint32_t version = 1;
+        uint32_t numNodes = m_nodeIds.size ();
+        m_block.insert (m_block.end (), "MOBTRACE", "MOBTRACE" + 8);
+        Append (&version, sizeof (version));
+        Append (&numNodes, sizeof (numNodes));
+        if (numNodes > 0)
+          {
+            Append (&m_nodeIds[0], numNodes * sizeof (uint32_t));
+          }
+      }
+    return true;
+  }
+
+  /// Take a snapshot every interval, the first at start
+  void
+  Start (Time interval, Time start = Seconds (0))
+  {
+    m_interval = interval;
+    m_running = true;
+    m_event = Simulator::Schedule (start, &MobilitySampler::Sample, this);
+  }
+
+  /// Stop sampling, write the buffered snapshots and close the file
+  bool
+  Stop (void)
+  {
+    if (m_running)
+      {
+        m_event.Cancel ();
+        m_running = false;
+      }
+    if (!m_writer.IsOpen ())
+      {
+        return true;
+      }
+    m_writer.Write (m_block);
+    return m_writer.Close ();
+  }
+
+private:
+  void
+  Sample (void)
+  {
+    double now = Simulator::Now ().GetSeconds ();
+    uint32_t n = m_models.size ();
+
+    // One contiguous snapshot of every node
+    m_snapshot.resize (n * 6);
+    for (uint32_t i = 0; i < n; i++)
+      {
+        Vector pos = m_models[i]->GetPosition ();
+        Vector vel = m_models[i]->GetVelocity ();
+        double *s = &m_snapshot[i * 6];
+        s[0] = pos.x; s[1] = pos.y; s[2] = pos.z;
+        s[3] = vel.x; s[4] = vel.y; s[5] = vel.z;
+      }
+
+    if (m_format == BINARY)
+      {
+        Append (&now, sizeof (now));
+        if (n > 0)
+          {
+            Append (&m_snapshot[0], m_snapshot.size () * sizeof (double));
+          }
+      }
+    else
+      {
+        char line[256];
+        for (uint32_t i = 0; i < n; i++)
+          {
+            const double *s = &m_snapshot[i * 6];
+            int len = std::snprintf (line, sizeof (line), "%g,%u,%u,%g,%g,%g,%g,%g,%g\n",
+                                     now, i, m_nodeIds[i], s[0], s[1], s[2], s[3], s[4], s[5]);
+            m_block.insert (m_block.end (), line, line + len);
+          }
+      }
+
+    if (++m_ticks % m_ticksPerFlush == 0)
+      {
+        m_writer.Write (m_block);
+      }
+    m_event = Simulator::Schedule (m_interval, &MobilitySampler::Sample, this);
+  }
+
+  void
+  Append (const void *data, size_t size)
+  {
+    const char *bytes = static_cast<const char *> (data);
+    m_block.insert (m_block.end (), bytes, bytes + size);
+  }
+
+  std::vector<Ptr<MobilityModel> > m_models;
+  std::vector<uint32_t> m_nodeIds;
+  std::vector<double> m_snapshot;   // x y z vx vy vz of every node
+  std::vector<char> m_block;        // encoded snapshots waiting for a write
+  AsyncBlockWriter m_writer;
+  Format m_format;
+  uint32_t m_ticksPerFlush;
+  uint64_t m_ticks;
+  Time m_interval;
+  EventId m_event;
+  bool m_running;
+};
+
+} // namespace ns3
+
+#endif /* MOBILITY_SAMPLER_H */
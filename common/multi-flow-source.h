@@ -0,0 +1,223 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef MULTI_FLOW_SOURCE_H
+#define MULTI_FLOW_SOURCE_H
+
+#include <functional>
+#include <queue>
+#include <utility>
+#include <vector>
+#include <stdint.h>
+
+#include "ns3/abort.h"
+#include "ns3/address.h"
+#include "ns3/application.h"
+#include "ns3/boolean.h"
+#include "ns3/data-rate.h"
+#include "ns3/event-id.h"
+#include "ns3/nstime.h"
+#include "ns3/packet.h"
+#include "ns3/simulator.h"
+#include "ns3/socket.h"
+#include "ns3/trace-source-accessor.h"
+#include "ns3/traced-callback.h"
+#include "ns3/type-id.h"
+#include "ns3/udp-socket-factory.h"
+
+#include "packet-pool.h"
+
+namespace ns3 {
+
+/**
+ * One application sending the traffic of many OnOffApplications: a table
+ * of flows, each with its destination, rate, packet size and constant
+ * on/off periods, all sent from a single socket and driven by a single
+ * timer. The flows are kept in flat arrays and their next send times in a
+ * heap; each timer event sends the packets of every flow due at that
+ * instant and is rescheduled to the earliest next one, so the events grow
+ * with the send instants and the objects stay one application and one
+ * socket, whatever the number of flows.
+ *
+ * A flow behaves as an OnOffApplication with ConstantRandomVariable on and
+ * off times: it starts in the on state, sends a packet every
+ * packetSize * 8 / rate seconds while on and nothing while off. An off
+ * time of 0 means always on.
+ *
+ *   Ptr<MultiFlowSource> source = CreateObject<MultiFlowSource> ();
+ *   remoteHost->AddApplication (source);
+ *   for (uint32_t u = 0; u < ueNodes.GetN (); u++)
+ *     {
+ *       source->AddFlow (InetSocketAddress (ueAddress[u], port), DataRate ("1Mb/s"), 1024);
+ *     }
+ *   source->SetStartTime (Seconds (0.1));
+ */
+class MultiFlowSource : public Application
+{
+public:
+  static TypeId
+  GetTypeId (void)
+  {
+    static TypeId tid = TypeId ("ns3::MultiFlowSource")
+      .SetParent<Application> ()
+      .SetGroupName ("Applications")
+      .AddConstructor<MultiFlowSource> ()
+      .AddAttribute ("Protocol", "The type of protocol to use",
+                     TypeIdValue (UdpSocketFactory::GetTypeId ()),
+                     MakeTypeIdAccessor (&MultiFlowSource::m_protocol),
+                     MakeTypeIdChecker ())
+      .AddAttribute ("PoolPackets", "Recycle the sent packets through the PacketPool "
+                     "(recycled packets keep their uid)",
+                     BooleanValue (true),
+                     MakeBooleanAccessor (&MultiFlowSource::m_poolPackets),
+                     MakeBooleanChecker ())
+      .AddTraceSource ("Tx", "A new packet is created and is sent",
+                       MakeTraceSourceAccessor (&MultiFlowSource::m_txTrace),
+                       "ns3::Packet::TracedCallback")
+    ;
+    return tid;
+  }
+
+  MultiFlowSource ()
+    : m_protocol (UdpSocketFactory::GetTypeId ()),
+      m_poolPackets (true)
+  {
+  }
+
+  /// Add a flow before the application starts, returns its index
+  uint32_t
+  AddFlow (Address destination, DataRate rate, uint32_t packetSize,
+           Time onTime = Seconds (0), Time offTime = Seconds (0))
+  {
+    NS_ABORT_MSG_UNLESS (rate.GetBitRate () > 0 && packetSize > 0, "MultiFlowSource: empty flow");
+    NS_ABORT_MSG_IF (offTime.IsStrictlyPositive () && !onTime.IsStrictlyPositive (),
+                     "MultiFlowSource: a flow with an off time needs an on time");
+    m_destinations.push_back (destination);
+    m_packetSizes.push_back (packetSize);
+    m_intervals.push_back (Seconds (packetSize * 8.0 / rate.GetBitRate ()).GetTimeStep ());
+    m_onTimes.push_back (onTime.GetTimeStep ());
+    m_offTimes.push_back (offTime.GetTimeStep ());
+    m_onEnds.push_back (0);
+    m_txBytes.push_back (0);
+    return m_destinations.size () - 1;
+  }
+
+  uint32_t GetNFlows (void) const { return m_destinations.size (); }
+  uint64_t GetTxBytes (uint32_t flow) const { return m_txBytes.at (flow); }
+
+protected:
+  virtual void
+  DoDispose (void)
+  {
+    m_socket = 0;
+    Application::DoDispose ();
+  }
+
+private:
+  typedef std::pair<int64_t, uint32_t> Due;   // time step, flow
+
+  virtual void
+  StartApplication (void)
+  {
+    m_socket = Socket::CreateSocket (GetNode (), m_protocol);
+    m_socket->Bind ();
+    m_socket->ShutdownRecv ();
+
+    int64_t now = Simulator::Now ().GetTimeStep ();
+    for (uint32_t i = 0; i < m_destinations.size (); i++)
+      {
+        m_onEnds[i] = now + m_onTimes[i];
+        m_due.push (Due (NextSend (i, now), i));
+      }
+    ScheduleNext (now);
+  }
+
+  virtual void
+  StopApplication (void)
+  {
+    Simulator::Cancel (m_event);
+    m_due = DueQueue ();
+    if (m_socket != 0)
+      {
+        m_socket->Close ();
+        m_socket = 0;
+      }
+  }
+
+  void
+  SendDue (void)
+  {
+    int64_t now = Simulator::Now ().GetTimeStep ();
+    while (!m_due.empty () && m_due.top ().first <= now)
+      {
+        uint32_t i = m_due.top ().second;
+        m_due.pop ();
+        Ptr<Packet> packet = m_poolPackets ? PacketPool::Get ().Allocate (m_packetSizes[i])
+                                           : Create<Packet> (m_packetSizes[i]);
+        m_txTrace (packet);
+        m_socket->SendTo (packet, 0, m_destinations[i]);
+        m_txBytes[i] += m_packetSizes[i];
+        m_due.push (Due (NextSend (i, now), i));
+      }
+    ScheduleNext (now);
+  }
+
+  // Next send of flow i after one at 'last', past its off periods
+  int64_t
+  NextSend (uint32_t i, int64_t last)
+  {
+    int64_t next = last + m_intervals[i];
+    while (m_offTimes[i] > 0 && next > m_onEnds[i])
+      {
+        int64_t onStart = m_onEnds[i] + m_offTimes[i];
+        m_onEnds[i] = onStart + m_onTimes[i];
+        next = onStart + m_intervals[i];
+      }
+    return next;
+  }
+
+  void
+  ScheduleNext (int64_t now)
+  {
+    if (!m_due.empty ())
+      {
+        m_event = Simulator::Schedule (TimeStep (m_due.top ().first - now), &MultiFlowSource::SendDue, this);
+      }
+  }
+
+  typedef std::priority_queue<Due, std::vector<Due>, std::greater<Due> > DueQueue;
+
+  TypeId m_protocol;
+  bool m_poolPackets;
+  Ptr<Socket> m_socket;
+  EventId m_event;
+  DueQueue m_due;
+
+  // One entry per flow, times in time steps
+  std::vector<Address> m_destinations;
+  std::vector<uint32_t> m_packetSizes;
+  std::vector<int64_t> m_intervals;
+  std::vector<int64_t> m_onTimes;
+  std::vector<int64_t> m_offTimes;
+  std::vector<int64_t> m_onEnds;      // end of the current on period
+  std::vector<uint64_t> m_txBytes;
+
+  TracedCallback<Ptr<const Packet> > m_txTrace;
+};
+
+} // namespace ns3
+
+#endif /* MULTI_FLOW_SOURCE_H */
@@ -0,0 +1,131 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PACKET_POOL_H
+#define PACKET_POOL_H
+
+#include <algorithm>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <stdint.h>
+
+#include "ns3/packet.h"
+
+namespace ns3 {
+
+/**
+ * Recycles the payload packets of the traffic sources (MultiFlowSource).
+ *
+ * ns-3 frees a Packet on its last Unref and gives no hook to take it back,
+ * so the pool keeps a reference to every packet it hands out, in one FIFO
+ * per packet size. A packet is free again once the pool holds its only
+ * reference: the UDP socket sends a copy and the packets are released in
+ * about the order they were sent, so only the oldest one of the size is
+ * checked, and moved to the back when still in use. A recycled packet has
+ * its packet and byte tags (e.g. the don't-fragment tag of the UDP socket)
+ * removed, the payload of a source packet is never touched; it keeps its
+ * old uid.
+ *
+ * A size holds at most MAX_PER_SIZE packets, the pool stops tracking the
+ * oldest one beyond that (e.g. packets queued for long in a buffer).
+ *
+ *   Ptr<Packet> p = PacketPool::Get ().Allocate (1024);
+ *   ...
+ *   PacketPool::Get ().Print (std::cout);
+ */
+class PacketPool
+{
+public:
+  static const uint32_t MAX_PER_SIZE = 4096;
+
+  static PacketPool &
+  Get (void)
+  {
+    static PacketPool pool;
+    return pool;
+  }
+
+  /// A packet of 'size' zero bytes, recycled when one is free
+  Ptr<Packet>
+  Allocate (uint32_t size)
+  {
+    std::deque<Ptr<Packet> > &list = m_lists[size];
+    Ptr<Packet> packet;
+    if (!list.empty () && list.front ()->GetReferenceCount () == 1)
+      {
+        packet = list.front ();
+        list.pop_front ();
+        packet->RemoveAllPacketTags ();
+        packet->RemoveAllByteTags ();
+        m_hits++;
+      }
+    else
+      {
+        packet = Create<Packet> (size);
+        m_misses++;
+        m_held++;
+        if (list.size () >= MAX_PER_SIZE)
+          {
+            list.pop_front ();
+            m_held--;
+          }
+        else if (!list.empty ())
+          {
+            // a packet held long (e.g. by a trace sink) goes to the back
+            list.push_back (list.front ());
+            list.pop_front ();
+          }
+      }
+    list.push_back (packet);
+    m_peakHeld = std::max (m_peakHeld, m_held);
+    return packet;
+  }
+
+  uint64_t GetHits (void) const { return m_hits; }
+  uint64_t GetMisses (void) const { return m_misses; }
+
+  /// Most packets held by the pool at once, over all sizes
+  uint64_t GetPeakOccupancy (void) const { return m_peakHeld; }
+
+  void
+  Print (std::ostream &os) const
+  {
+    uint64_t total = m_hits + m_misses;
+    os << "Packet pool: " << total << " packets, " << m_hits << " recycled ("
+       << (total > 0 ? 100.0 * m_hits / total : 0) << "%), " << m_misses << " allocated, peak "
+       << m_peakHeld << " held in " << m_lists.size () << " size(s)" << std::endl;
+  }
+
+private:
+  PacketPool ()
+    : m_hits (0),
+      m_misses (0),
+      m_held (0),
+      m_peakHeld (0)
+  {
+  }
+
+  std::map<uint32_t, std::deque<Ptr<Packet> > > m_lists;
+  uint64_t m_hits;
+  uint64_t m_misses;
+  uint64_t m_held;
+  uint64_t m_peakHeld;
+};
+
+} // namespace ns3
+
+#endif /* PACKET_POOL_H */
@@ -0,0 +1,268 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PHASE_TIMER_H
+#define PHASE_TIMER_H
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <stdint.h>
+#include <sys/resource.h>
+
+#include "ns3/abort.h"
+
+namespace ns3 {
+
+/**
+ * Wall time and peak RSS of the stages of a run (node creation, mobility,
+ * device install, addressing, attach, Simulator::Run, Simulator::Destroy).
+ *
+ * There is one timer per process, PhaseTimer::Get (), so that the scenario
+ * and the helpers it calls (e.g. LteScenarioBuilder) add to the same
+ * breakdown. Phases may nest, the total only counts the outermost ones.
+ *
+ *   PhaseTimer::Get ().Begin ("nodes");
+ *   ...
+ *   PhaseTimer::Get ().End ();
+ *   {
+ *     ScopedPhase phase ("run");
+ *     Simulator::Run ();
+ *   }
+ *   PhaseTimer::Get ().WriteJson ("PhaseTimes.json");
+ *
+ * The JSON file has one entry per finished phase, in the order they
+ * started:
+ *
+ *   { "phases": [ { "name": "run", "depth": 0, "wall_s": 12.345, "peak_rss_kb": 81234 }, ... ],
+ *     "total_wall_s": 14.2, "elapsed_wall_s": 14.3, "events": 1234567, "sim_s": 3,
+ *     "peak_rss_kb": 81234 }
+ *
+ * peak_rss_kb of a phase is the process peak at its end, so an increase
+ * over the previous phase is memory that phase needed. Numbers set with
+ * SetValue (here "events" and "sim_s") are written after the totals.
+ */
+class PhaseTimer
+{
+public:
+  struct Phase
+  {
+    std::string name;
+    uint32_t depth;
+    double seconds;     // -1 while running
+    long peakRssKb;
+  };
+
+  static PhaseTimer &
+  Get (void)
+  {
+    static PhaseTimer timer;
+    return timer;
+  }
+
+  void
+  Begin (std::string name)
+  {
+    Phase phase;
+    phase.name = name;
+    phase.depth = m_open.size ();
+    phase.seconds = -1;
+    phase.peakRssKb = 0;
+    m_phases.push_back (phase);
+
+    Open open;
+    open.index = m_phases.size () - 1;
+    open.start = Clock::now ();
+    m_open.push_back (open);
+  }
+
+  void
+  End (void)
+  {
+    NS_ABORT_MSG_IF (m_open.empty (), "PhaseTimer: End () without Begin ()");
+    Phase &phase = m_phases[m_open.back ().index];
+    phase.seconds = std::chrono::duration<double> (Clock::now () - m_open.back ().start).count ();
+    phase.peakRssKb = GetPeakRssKb ();
+    m_open.pop_back ();
+  }
+
+  const std::vector<Phase> & GetPhases (void) const { return m_phases; }
+
+  /// Seconds spent in a phase, summed over its repetitions
+  double
+  GetSeconds (std::string name) const
+  {
+    double total = 0;
+    for (uint32_t i = 0; i < m_phases.size (); i++)
+      {
+        total += m_phases[i].name == name && m_phases[i].seconds >= 0 ? m_phases[i].seconds : 0;
+      }
+    return total;
+  }
+
+  /// Seconds in the outermost phases
+  double
+  GetTotalSeconds (void) const
+  {
+    double total = 0;
+    for (uint32_t i = 0; i < m_phases.size (); i++)
+      {
+        total += m_phases[i].depth == 0 && m_phases[i].seconds >= 0 ? m_phases[i].seconds : 0;
+      }
+    return total;
+  }
+
+  /// Seconds since the timer was first used
+  double
+  GetElapsedSeconds (void) const
+  {
+    return std::chrono::duration<double> (Clock::now () - m_created).count ();
+  }
+
+  /// A number of the run written at the top level of the JSON file,
+  /// e.g. Simulator::GetEventCount () after Simulator::Run ()
+  void
+  SetValue (std::string key, double value)
+  {
+    std::ostringstream oss;
+    oss << std::setprecision (15) << value;
+    for (uint32_t i = 0; i < m_values.size (); i++)
+      {
+        if (m_values[i].first == key)
+          {
+            m_values[i].second = oss.str ();
+            return;
+          }
+      }
+    m_values.push_back (std::make_pair (key, oss.str ()));
+  }
+
+  /// One line per finished phase, nested phases indented under their parent
+  void
+  Print (std::ostream &os) const
+  {
+    std::ios_base::fmtflags flags = os.flags ();
+    std::streamsize precision = os.precision ();
+    os << "Phases:" << std::endl;
+    for (uint32_t i = 0; i < m_phases.size (); i++)
+      {
+        const Phase &p = m_phases[i];
+        if (p.seconds < 0)
+          {
+            continue;
+          }
+        os << std::string (4 + 2 * p.depth, ' ') << std::left << std::setw (20 - 2 * p.depth) << p.name
+           << std::right << std::fixed << std::setprecision (3) << std::setw (10) << p.seconds << " s"
+           << std::setw (10) << p.peakRssKb << " KB" << std::endl;
+      }
+    os << "    " << std::left << std::setw (20) << "total" << std::right << std::fixed << std::setprecision (3)
+       << std::setw (10) << GetTotalSeconds () << " s" << std::setw (10) << GetPeakRssKb () << " KB" << std::endl;
+    os.flags (flags);
+    os.precision (precision);
+  }
+
+  bool
+  WriteJson (std::string filename) const
+  {
+    std::ofstream out (filename.c_str ());
+    if (!out.is_open ())
+      {
+        return false;
+      }
+    out << std::fixed << std::setprecision (6);
+    out << "{\n  \"phases\": [";
+    bool first = true;
+    for (uint32_t i = 0; i < m_phases.size (); i++)
+      {
+        const Phase &p = m_phases[i];
+        if (p.seconds < 0)
+          {
+            continue;
+          }
+        out << (first ? "\n" : ",\n") << "    { \"name\": \"" << p.name << "\", \"depth\": " << p.depth
+            << ", \"wall_s\": " << p.seconds << ", \"peak_rss_kb\": " << p.peakRssKb << " }";
+        first = false;
+      }
+    out << "\n  ],\n"
+        << "  \"total_wall_s\": " << GetTotalSeconds () << ",\n"
+        << "  \"elapsed_wall_s\": " << GetElapsedSeconds () << ",\n";
+    for (uint32_t i = 0; i < m_values.size (); i++)
+      {
+        out << "  \"" << m_values[i].first << "\": " << m_values[i].second << ",\n";
+      }
+    out << "  \"peak_rss_kb\": " << GetPeakRssKb () << "\n}\n";
+    return out.good ();
+  }
+
+  static long
+  GetPeakRssKb (void)
+  {
+    struct rusage ru;
+    getrusage (RUSAGE_SELF, &ru);
+#ifdef __APPLE__
+    return ru.ru_maxrss / 1024;   // bytes on OS X
+#else
+    return ru.ru_maxrss;          // kilobytes on Linux
+#endif
+  }
+
+private:
+  typedef std::chrono::steady_clock Clock;
+
+  struct Open
+  {
+    uint32_t index;     // in m_phases
+    Clock::time_point start;
+  };
+
+  PhaseTimer ()
+    : m_created (Clock::now ())
+  {
+  }
+
+  Clock::time_point m_created;
+  std::vector<Open> m_open;
+  std::vector<Phase> m_phases;
+  std::vector<std::pair<std::string, std::string> > m_values;
+};
+
+/// A phase of PhaseTimer::Get () lasting until the end of the scope
+class ScopedPhase
+{
+public:
+  ScopedPhase (std::string name)
+  {
+    PhaseTimer::Get ().Begin (name);
+  }
+
+  ~ScopedPhase ()
+  {
+    PhaseTimer::Get ().End ();
+  }
+
+private:
+  ScopedPhase (const ScopedPhase &);
+  ScopedPhase & operator= (const ScopedPhase &);
+};
+
+} // namespace ns3
+
+#endif /* PHASE_TIMER_H */
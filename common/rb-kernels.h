@@ -0,0 +1,264 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef RB_KERNELS_H
+#define RB_KERNELS_H
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <stdint.h>
+
+#include "ns3/assert.h"
+
+#if defined (__AVX__)
+#include <immintrin.h>
+#elif defined (__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace ns3 {
+
+/*
+ * Per-RB power kernels: one value per resource block (a PSD in W/Hz or a
+ * linear gain), in contiguous arrays. The loops run 4 doubles at a time
+ * with AVX, 2 with SSE2 (always there on x86-64) and one at a time
+ * elsewhere; AVX needs a build with -mavx or -march=native, as the ns-3
+ * optimized profile does. Unaligned loads are used, so the kernels also
+ * work on the std::vector behind a SpectrumValue; RbPowerVector gives 64
+ * byte aligned storage padded to a whole number of vectors.
+ *
+ * RbSimdWidth () tells which path was compiled in.
+ */
+
+/// Doubles per SIMD operation in this build, 1 without SIMD
+inline uint32_t
+RbSimdWidth (void)
+{
+#if defined (__AVX__)
+  return 4;
+#elif defined (__SSE2__)
+  return 2;
+#else
+  return 1;
+#endif
+}
+
+/// acc[i] += x[i], e.g. the sum of the interferers
+inline void
+RbAccumulate (double *acc, const double *x, uint32_t n)
+{
+  uint32_t i = 0;
+#if defined (__AVX__)
+  for (; i + 4 <= n; i += 4)
+    {
+      _mm256_storeu_pd (acc + i, _mm256_add_pd (_mm256_loadu_pd (acc + i), _mm256_loadu_pd (x + i)));
+    }
+#elif defined (__SSE2__)
+  for (; i + 2 <= n; i += 2)
+    {
+      _mm_storeu_pd (acc + i, _mm_add_pd (_mm_loadu_pd (acc + i), _mm_loadu_pd (x + i)));
+    }
+#endif
+  for (; i < n; i++)
+    {
+      acc[i] += x[i];
+    }
+}
+
+/// x[i] *= gain[i], e.g. a fading realization in linear units
+inline void
+RbMultiply (double *x, const double *gain, uint32_t n)
+{
+  uint32_t i = 0;
+#if defined (__AVX__)
+  for (; i + 4 <= n; i += 4)
+    {
+      _mm256_storeu_pd (x + i, _mm256_mul_pd (_mm256_loadu_pd (x + i), _mm256_loadu_pd (gain + i)));
+    }
+#elif defined (__SSE2__)
+  for (; i + 2 <= n; i += 2)
+    {
+      _mm_storeu_pd (x + i, _mm_mul_pd (_mm_loadu_pd (x + i), _mm_loadu_pd (gain + i)));
+    }
+#endif
+  for (; i < n; i++)
+    {
+      x[i] *= gain[i];
+    }
+}
+
+/// x[i] *= gain[i] with single precision gains (the fading traces are float)
+inline void
+RbMultiply (double *x, const float *gain, uint32_t n)
+{
+  uint32_t i = 0;
+#if defined (__AVX__)
+  for (; i + 4 <= n; i += 4)
+    {
+      __m256d g = _mm256_cvtps_pd (_mm_loadu_ps (gain + i));
+      _mm256_storeu_pd (x + i, _mm256_mul_pd (_mm256_loadu_pd (x + i), g));
+    }
+#elif defined (__SSE2__)
+  for (; i + 2 <= n; i += 2)
+    {
+      __m128d g = _mm_cvtps_pd (_mm_castsi128_ps (_mm_loadl_epi64 (reinterpret_cast<const __m128i *> (gain + i))));
+      _mm_storeu_pd (x + i, _mm_mul_pd (_mm_loadu_pd (x + i), g));
+    }
+#endif
+  for (; i < n; i++)
+    {
+      x[i] *= gain[i];
+    }
+}
+
+/// sinr[i] = signal[i] / (interference[i] + noise[i])
+inline void
+RbSinr (double *sinr, const double *signal, const double *interference, const double *noise, uint32_t n)
+{
+  uint32_t i = 0;
+#if defined (__AVX__)
+  for (; i + 4 <= n; i += 4)
+    {
+      __m256d in = _mm256_add_pd (_mm256_loadu_pd (interference + i), _mm256_loadu_pd (noise + i));
+      _mm256_storeu_pd (sinr + i, _mm256_div_pd (_mm256_loadu_pd (signal + i), in));
+    }
+#elif defined (__SSE2__)
+  for (; i + 2 <= n; i += 2)
+    {
+      __m128d in = _mm_add_pd (_mm_loadu_pd (interference + i), _mm_loadu_pd (noise + i));
+      _mm_storeu_pd (sinr + i, _mm_div_pd (_mm_loadu_pd (signal + i), in));
+    }
+#endif
+  for (; i < n; i++)
+    {
+      sinr[i] = signal[i] / (interference[i] + noise[i]);
+    }
+}
+
+/**
+ * out[i] = 10^(db[i * stride] / 10), single precision: the dB to linear
+ * conversion of a fading trace column. The exponential stays scalar (there
+ * is no SIMD exp in the standard library), it is meant to be done once per
+ * sample and cached, not per transmission.
+ */
+inline void
+RbDbToLinear (float *out, const float *db, uint32_t stride, uint32_t n)
+{
+  const float scale = std::log (10.0f) / 10.0f;
+  for (uint32_t i = 0; i < n; i++)
+    {
+      out[i] = std::exp (db[(size_t) i * stride] * scale);
+    }
+}
+
+/// 64 byte aligned per-RB array of doubles, zero initialized
+class RbPowerVector
+{
+public:
+  explicit RbPowerVector (uint32_t n = 0)
+    : m_data (0),
+      m_size (0),
+      m_capacity (0)
+  {
+    Resize (n);
+  }
+
+  RbPowerVector (const RbPowerVector &o)
+    : m_data (0),
+      m_size (0),
+      m_capacity (0)
+  {
+    *this = o;
+  }
+
+  RbPowerVector &
+  operator= (const RbPowerVector &o)
+  {
+    if (this != &o)
+      {
+        Resize (o.m_size);
+        std::memcpy (m_data, o.m_data, m_size * sizeof (double));
+      }
+    return *this;
+  }
+
+  ~RbPowerVector ()
+  {
+    std::free (m_data);
+  }
+
+  /// Resize to n values, all zero
+  void
+  Resize (uint32_t n)
+  {
+    uint32_t capacity = (n + 7) & ~7u;      // a whole number of 64 byte lines
+    if (capacity > m_capacity)
+      {
+        std::free (m_data);
+        void *p = 0;
+        if (posix_memalign (&p, 64, capacity * sizeof (double)) != 0)
+          {
+            throw std::bad_alloc ();
+          }
+        m_data = static_cast<double *> (p);
+        m_capacity = capacity;
+      }
+    m_size = n;
+    Fill (0);
+  }
+
+  void
+  Fill (double value)
+  {
+    for (uint32_t i = 0; i < m_capacity; i++)
+      {
+        m_data[i] = value;
+      }
+  }
+
+  uint32_t GetSize (void) const { return m_size; }
+  double *Data (void) { return m_data; }
+  const double *Data (void) const { return m_data; }
+  double &operator[] (uint32_t i) { return m_data[i]; }
+  double operator[] (uint32_t i) const { return m_data[i]; }
+
+  RbPowerVector &
+  operator+= (const RbPowerVector &o)
+  {
+    NS_ASSERT (o.m_size == m_size);
+    RbAccumulate (m_data, o.m_data, m_size);
+    return *this;
+  }
+
+  RbPowerVector &
+  operator*= (const RbPowerVector &o)
+  {
+    NS_ASSERT (o.m_size == m_size);
+    RbMultiply (m_data, o.m_data, m_size);
+    return *this;
+  }
+
+private:
+  double *m_data;
+  uint32_t m_size;
+  uint32_t m_capacity;
+};
+
+} // namespace ns3
+
+#endif /* RB_KERNELS_H */
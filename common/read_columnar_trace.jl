@@ -0,0 +1,64 @@
+# Reader for the block-columnar traces (.ctr) of columnar-trace-writer.h
+#
+#   include("../common/read_columnar_trace.jl")
+#   trace = read_columnar_trace( "./DlRsrpSinrStats.ctr" );   # Dict: column name => vector
+#   data  = columnar_trace_matrix( trace, ["time","cellId","IMSI","RNTI","rsrp","sinr"] );
+
+function read_varints!( out, bytes, first )
+    pos   = 1;
+    value = Int64(0);
+    for i = 1:length(out)
+        x     = UInt64(0);
+        shift = 0;
+        while true
+            b     = bytes[pos];
+            pos  += 1;
+            x    |= UInt64(b & 0x7f) << shift;
+            shift += 7;
+            (b & 0x80) == 0 && break;
+        end
+        delta  = reinterpret( Int64, x >> 1 ) ⊻ -reinterpret( Int64, x & 1 );
+        value += delta;
+        out[first+i-1] = value;
+    end
+end
+
+function read_columnar_trace( filename )
+    open( filename ) do io
+        String( read(io, UInt8, 8) ) == "COLTRACE" || error( "$filename is not a columnar trace" );
+        read( io, UInt32 ) == 1 || error( "Unsupported columnar trace version" );
+        numColumns = read( io, UInt32 );
+        names = String[];
+        types = UInt8[];
+        for c = 1:numColumns
+            push!( types, read(io, UInt8) );
+            push!( names, String( read(io, UInt8, Int(read(io, UInt8))) ) );
+        end
+
+        columns = [ types[c] == 2 ? Float32[] : Int64[] for c = 1:numColumns ];
+        while !eof(io)
+            numRows = read( io, UInt32 );
+            for c = 1:numColumns
+                bytes = read( io, UInt8, Int(read(io, UInt32)) );
+                first = length(columns[c]) + 1;
+                resize!( columns[c], length(columns[c]) + numRows );
+                if types[c] == 2
+                    columns[c][first:end] = reinterpret( Float32, bytes );
+                else
+                    read_varints!( columns[c], bytes, first );
+                end
+            end
+        end
+
+        trace = Dict{String,Any}();
+        for c = 1:numColumns
+            trace[names[c]] = types[c] == 0 ? columns[c] / 1e9 : columns[c];   # time in s
+        end
+        trace
+    end
+end
+
+# Same layout as readdlm() of the text trace
+function columnar_trace_matrix( trace, names )
+    hcat( [ Float64.(trace[name]) for name in names ]... )
+end
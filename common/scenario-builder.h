@@ -0,0 +1,295 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef SCENARIO_BUILDER_H
+#define SCENARIO_BUILDER_H
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ns3/abort.h"
+#include "ns3/config.h"
+#include "ns3/data-rate.h"
+#include "ns3/internet-stack-helper.h"
+#include "ns3/ipv4-address-helper.h"
+#include "ns3/ipv4-interface-container.h"
+#include "ns3/ipv4-static-routing-helper.h"
+#include "ns3/ipv4-static-routing.h"
+#include "ns3/ipv4.h"
+#include "ns3/lte-helper.h"
+#include "ns3/mobility-model.h"
+#include "ns3/net-device-container.h"
+#include "ns3/node-container.h"
+#include "ns3/nstime.h"
+#include "ns3/point-to-point-epc-helper.h"
+#include "ns3/point-to-point-helper.h"
+#include "ns3/simulator.h"
+#include "ns3/uinteger.h"
+
+#include "lte-device-registry.h"
+#include "phase-timer.h"
+
+namespace ns3 {
+
+/**
+ * Setup shared by the LTE scenarios: the LteHelper with its EPC, remote
+ * hosts behind the PGW and the UE side of the IP network.
+ *
+ * Each remote host i gets its own point to point link to the PGW in
+ * 1.i.0.0/16 (so the first one is 1.0.0.2 as before) and a route to the UE
+ * network 7.0.0.0/8. UEs are set up in bulk: one stack install, one address
+ * assignment and one pass setting the default routes, over the whole
+ * container. The stacks are IPv4 only unless SetIpv6 (true) is called, the
+ * EPC does not use IPv6 and it is most of the cost of an install.
+ *
+ * Every setup call is a phase of PhaseTimer::Get (), next to the ones the
+ * scenario adds around its own stages. The devices installed through the
+ * builder are added to its LteDeviceRegistry.
+ *
+ *   LteScenarioBuilder scenario;
+ *   Ptr<LteHelper> lteHelper = scenario.GetLteHelper ();
+ *   Ptr<Node> remoteHost = scenario.CreateRemoteHosts (1).Get (0);
+ *   NetDeviceContainer enbDevs = scenario.InstallEnbDevices (enbNodes);
+ *   NetDeviceContainer ueDevs = scenario.InstallUeDevices (ueNodes);
+ *   scenario.InstallUeInternet (ueNodes, ueDevs);
+ *   scenario.Attach (ueDevs, enbDevs.Get (0));
+ */
+class LteScenarioBuilder
+{
+public:
+  enum Core
+  {
+    NO_EPC,     ///< radio only, no IP network
+    EPC         ///< PointToPointEpcHelper, remote hosts and UE addresses
+  };
+
+  LteScenarioBuilder (Core core = EPC)
+    : m_ipv6 (false)
+  {
+    Start ("lte-helper");
+    m_lteHelper = CreateObject<LteHelper> ();
+    if (core == EPC)
+      {
+        m_epcHelper = CreateObject<PointToPointEpcHelper> ();
+        m_lteHelper->SetEpcHelper (m_epcHelper);
+      }
+    m_backhaul.SetDeviceAttribute ("DataRate", DataRateValue (DataRate ("100Gb/s")));
+    m_backhaul.SetDeviceAttribute ("Mtu", UintegerValue (1500));
+    m_backhaul.SetChannelAttribute ("Delay", TimeValue (Seconds (0.010)));
+    End ();
+  }
+
+  Ptr<LteHelper> GetLteHelper (void) const { return m_lteHelper; }
+  Ptr<PointToPointEpcHelper> GetEpcHelper (void) const { return m_epcHelper; }
+
+  Ptr<Node>
+  GetPgwNode (void) const
+  {
+    NS_ABORT_MSG_UNLESS (m_epcHelper != 0, "LteScenarioBuilder: no EPC");
+    return m_epcHelper->GetPgwNode ();
+  }
+
+  /// Install IPv6 as well on the nodes set up from now on
+  void SetIpv6 (bool enable) { m_ipv6 = enable; }
+
+  /// The PGW - remote host links, 100Gb/s, MTU 1500 and 10 ms by default
+  PointToPointHelper & GetBackhaul (void) { return m_backhaul; }
+
+  /// Create n remote hosts and connect them to the PGW
+  NodeContainer
+  CreateRemoteHosts (uint32_t n = 1)
+  {
+    NodeContainer hosts;
+    hosts.Create (n);
+    InstallRemoteHosts (hosts);
+    return hosts;
+  }
+
+  /// Connect already created remote hosts (e.g. placed on MPI ranks) to the PGW
+  void
+  InstallRemoteHosts (NodeContainer hosts)
+  {
+    Ptr<Node> pgw = GetPgwNode ();
+    Start ("remote-hosts");
+    GetInternetStack ().Install (hosts);
+    Ipv4AddressHelper ipv4Helper;
+    Ipv4StaticRoutingHelper routingHelper;
+    for (uint32_t i = 0; i < hosts.GetN (); i++)
+      {
+        uint32_t idx = m_remoteHosts.GetN ();
+        NS_ABORT_MSG_UNLESS (idx < 256, "LteScenarioBuilder: at most 256 remote hosts");
+        std::ostringstream base;
+        base << "1." << idx << ".0.0";
+        ipv4Helper.SetBase (base.str ().c_str (), "255.255.0.0");
+        Ipv4InterfaceContainer ifaces = ipv4Helper.Assign (m_backhaul.Install (pgw, hosts.Get (i)));
+        m_remoteHostAddresses.push_back (ifaces.GetAddress (1));
+        m_remoteHosts.Add (hosts.Get (i));
+
+        Ptr<Ipv4StaticRouting> routing = routingHelper.GetStaticRouting (hosts.Get (i)->GetObject<Ipv4> ());
+        routing->AddNetworkRouteTo (Ipv4Address ("7.0.0.0"), Ipv4Mask ("255.0.0.0"), 1);
+      }
+    End ();
+  }
+
+  NodeContainer GetRemoteHosts (void) const { return m_remoteHosts; }
+  Ipv4Address GetRemoteHostAddress (uint32_t i = 0) const { return m_remoteHostAddresses.at (i); }
+
+  /// The eNB and UE devices installed so far
+  const LteDeviceRegistry & GetDeviceRegistry (void) const { return m_registry; }
+
+  NetDeviceContainer
+  InstallEnbDevices (NodeContainer enbNodes)
+  {
+    Start ("enb-devices");
+    NetDeviceContainer devs = m_lteHelper->InstallEnbDevice (enbNodes);
+    m_registry.AddEnbDevices (devs);
+    End ();
+    return devs;
+  }
+
+  NetDeviceContainer
+  InstallUeDevices (NodeContainer ueNodes)
+  {
+    Start ("ue-devices");
+    NetDeviceContainer devs = m_lteHelper->InstallUeDevice (ueNodes);
+    m_registry.AddUeDevices (devs);
+    End ();
+    return devs;
+  }
+
+  /**
+   * Internet stack, EPC addresses and the default route of every UE.
+   * ueNodes and ueDevs must be in the same order.
+   */
+  Ipv4InterfaceContainer
+  InstallUeInternet (NodeContainer ueNodes, NetDeviceContainer ueDevs)
+  {
+    NS_ABORT_MSG_UNLESS (m_epcHelper != 0, "LteScenarioBuilder: no EPC");
+    NS_ABORT_MSG_UNLESS (ueNodes.GetN () == ueDevs.GetN (), "LteScenarioBuilder: " << ueNodes.GetN ()
+                         << " UE nodes but " << ueDevs.GetN () << " UE devices");
+    Start ("ue-stacks");
+    GetInternetStack ().Install (ueNodes);
+    End ();
+
+    Start ("ue-addresses");
+    Ipv4InterfaceContainer ifaces = m_epcHelper->AssignUeIpv4Address (ueDevs);
+    End ();
+
+    Start ("ue-routes");
+    Ipv4Address gateway = m_epcHelper->GetUeDefaultGatewayAddress ();
+    Ipv4StaticRoutingHelper routingHelper;
+    for (NodeContainer::Iterator it = ueNodes.Begin (); it != ueNodes.End (); ++it)
+      {
+        routingHelper.GetStaticRouting ((*it)->GetObject<Ipv4> ())->SetDefaultRoute (gateway, 1);
+      }
+    End ();
+    return ifaces;
+  }
+
+  /// Attach all UEs to one eNB
+  void
+  Attach (NetDeviceContainer ueDevs, Ptr<NetDevice> enbDev)
+  {
+    Start ("attach");
+    m_lteHelper->Attach (ueDevs, enbDev);
+    End ();
+  }
+
+  /// Attach every UE to the closest eNB
+  void
+  Attach (NetDeviceContainer ueDevs)
+  {
+    Start ("attach");
+    m_lteHelper->Attach (ueDevs);
+    End ();
+  }
+
+private:
+  InternetStackHelper &
+  GetInternetStack (void)
+  {
+    m_internet.SetIpv6StackInstall (m_ipv6);
+    return m_internet;
+  }
+
+  void
+  Start (std::string phase)
+  {
+    PhaseTimer::Get ().Begin (phase);
+  }
+
+  void
+  End (void)
+  {
+    PhaseTimer::Get ().End ();
+  }
+
+  Ptr<LteHelper> m_lteHelper;
+  Ptr<PointToPointEpcHelper> m_epcHelper;
+  PointToPointHelper m_backhaul;
+  InternetStackHelper m_internet;
+  bool m_ipv6;
+
+  NodeContainer m_remoteHosts;
+  std::vector<Ipv4Address> m_remoteHostAddresses;
+  LteDeviceRegistry m_registry;
+};
+
+/// Print a course change of a mobility model, connect it to
+/// "/NodeList/*/$ns3::MobilityModel/CourseChange"
+inline void
+PrintCourseChange (std::string context, Ptr<const MobilityModel> mobility)
+{
+  Vector pos = mobility->GetPosition ();
+  Vector vel = mobility->GetVelocity ();
+  std::cout << Simulator::Now ()
+            << " Trace:" << context << "    "
+            << " POS: (" << pos.x << "," << pos.y << "," << pos.z << ")"
+            << " VEL: (" << vel.x << "," << vel.y << "," << vel.z << ")" << std::endl;
+}
+
+/// Print the position of every node now and again every interval
+inline void
+PrintPositions (NodeContainer nodes, Time interval)
+{
+  for (NodeContainer::Iterator it = nodes.Begin (); it != nodes.End (); ++it)
+    {
+      Ptr<MobilityModel> mobility = (*it)->GetObject<MobilityModel> ();
+      Vector pos = mobility->GetPosition ();
+      Vector vel = mobility->GetVelocity ();
+      std::cout << Simulator::Now ()
+                << " Node#" << (*it)->GetId ()
+                << " POS: (" << pos.x << "," << pos.y << "," << pos.z << ")"
+                << " VEL: (" << vel.x << "," << vel.y << "," << vel.z << ")"
+                << std::endl;
+    }
+  Simulator::Schedule (interval, &PrintPositions, nodes, interval);
+}
+
+/// Print every course change and the position of nodes every interval,
+/// from the start of the simulation
+inline void
+EnableMobilityTracking (NodeContainer nodes, Time interval = Seconds (1))
+{
+  Config::Connect ("/NodeList/*/$ns3::MobilityModel/CourseChange", MakeCallback (&PrintCourseChange));
+  Simulator::ScheduleNow (&PrintPositions, nodes, interval);
+}
+
+} // namespace ns3
+
+#endif /* SCENARIO_BUILDER_H */
@@ -0,0 +1,75 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef SCHEDULER_TYPE_H
+#define SCHEDULER_TYPE_H
+
+#include <string>
+
+#include "ns3/abort.h"
+#include "ns3/global-value.h"
+#include "ns3/string.h"
+
+namespace ns3 {
+
+/**
+ * The event queue of the simulator, by short name:
+ *
+ *   map       ns3::MapScheduler (the ns-3 default)
+ *   heap      ns3::HeapScheduler
+ *   list      ns3::ListScheduler
+ *   calendar  ns3::CalendarScheduler
+ *
+ * A full TypeId name is used as is and an empty name leaves SchedulerType
+ * alone (it may come from --SchedulerType or a ConfigStore file). Call it
+ * before the first Simulator call, which creates the queue.
+ */
+inline void
+SelectScheduler (std::string name)
+{
+  std::string typeName;
+  if (name.empty ())
+    {
+      return;
+    }
+  else if (name == "map")
+    {
+      typeName = "ns3::MapScheduler";
+    }
+  else if (name == "heap")
+    {
+      typeName = "ns3::HeapScheduler";
+    }
+  else if (name == "list")
+    {
+      typeName = "ns3::ListScheduler";
+    }
+  else if (name == "calendar")
+    {
+      typeName = "ns3::CalendarScheduler";
+    }
+  else
+    {
+      NS_ABORT_MSG_UNLESS (name.find ("::") != std::string::npos,
+                           "Unknown scheduler " << name << ", use map, heap, list or calendar");
+      typeName = name;
+    }
+  GlobalValue::Bind ("SchedulerType", StringValue (typeName));
+}
+
+} // namespace ns3
+
+#endif /* SCHEDULER_TYPE_H */
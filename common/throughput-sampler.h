@@ -0,0 +1,179 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef THROUGHPUT_SAMPLER_H
+#define THROUGHPUT_SAMPLER_H
+
+#include <sstream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "ns3/event-id.h"
+#include "ns3/flow-monitor.h"
+#include "ns3/gnuplot.h"
+#include "ns3/ipv4-flow-classifier.h"
+#include "ns3/log.h"
+#include "ns3/nstime.h"
+#include "ns3/simulator.h"
+
+#include "flow-counters.h"
+
+namespace ns3 {
+
+/**
+ * Periodic per-flow throughput of a FlowMonitor or of FlowCounters.
+ *
+ * Every interval the received bytes of each flow are compared with the
+ * previous sample, so a tick costs one pass over the flow stats and no
+ * copies; the per-flow state is a flat vector indexed by FlowId and the
+ * classifier is only asked about flows seen for the first time. Each flow
+ * gets its own Gnuplot2dDataset of throughput (Mbps) over time.
+ *
+ *   ThroughputSampler sampler (monitor, DynamicCast<Ipv4FlowClassifier> (helper.GetClassifier ()), Seconds (0.25));
+ *   sampler.Start ();
+ *   Simulator::Run ();
+ *   sampler.AddDatasets (gnuplot);
+ *   monitor->SerializeToXmlFile ("ThroughputMonitor.xml", true, true);
+ *
+ * or ThroughputSampler sampler (&counters, Seconds (0.25)) for FlowCounters.
+ */
+class ThroughputSampler
+{
+public:
+  ThroughputSampler (Ptr<FlowMonitor> monitor, Ptr<Ipv4FlowClassifier> classifier, Time interval)
+    : m_monitor (monitor),
+      m_classifier (classifier),
+      m_counters (0),
+      m_interval (interval)
+  {
+  }
+
+  ThroughputSampler (const FlowCounters *counters, Time interval)
+    : m_counters (counters),
+      m_interval (interval)
+  {
+  }
+
+  void
+  Start (Time start = Seconds (0))
+  {
+    m_event = Simulator::Schedule (start, &ThroughputSampler::Sample, this);
+  }
+
+  void
+  Stop (void)
+  {
+    m_event.Cancel ();
+  }
+
+  /// Add the dataset of every flow seen so far to plot
+  void
+  AddDatasets (Gnuplot &plot) const
+  {
+    for (uint32_t id = 0; id < m_flows.size (); id++)
+      {
+        if (m_flows[id].seen)
+          {
+            plot.AddDataset (m_flows[id].dataset);
+          }
+      }
+  }
+
+  uint32_t
+  GetNFlows (void) const
+  {
+    uint32_t n = 0;
+    for (uint32_t id = 0; id < m_flows.size (); id++)
+      {
+        n += m_flows[id].seen ? 1 : 0;
+      }
+    return n;
+  }
+
+private:
+  struct FlowState
+  {
+    FlowState ()
+      : seen (false),
+        lastRxBytes (0)
+    {
+    }
+
+    bool seen;
+    uint64_t lastRxBytes;
+    Gnuplot2dDataset dataset;
+  };
+
+  void
+  Sample (void)
+  {
+    double now = Simulator::Now ().GetSeconds ();
+    if (m_counters != 0)
+      {
+        for (uint32_t i = 0; i < m_counters->GetNFlows (); i++)
+          {
+            AddSample (i + 1, m_counters->GetFiveTuple (i), m_counters->GetRxBytes (i), now);
+          }
+      }
+    else
+      {
+        const FlowMonitor::FlowStatsContainer &stats = m_monitor->GetFlowStats ();
+        for (FlowMonitor::FlowStatsContainerCI it = stats.begin (); it != stats.end (); ++it)
+          {
+            FlowId id = it->first;
+            bool seen = id < m_flows.size () && m_flows[id].seen;
+            AddSample (id, seen ? Ipv4FlowClassifier::FiveTuple () : m_classifier->FindFlow (id),
+                       it->second.rxBytes, now);
+          }
+      }
+    m_event = Simulator::Schedule (m_interval, &ThroughputSampler::Sample, this);
+  }
+
+  // The five tuple is only read the first time the flow is seen
+  void
+  AddSample (uint32_t id, const Ipv4FlowClassifier::FiveTuple &t, uint64_t rxBytes, double now)
+  {
+    if (id >= m_flows.size ())
+      {
+        m_flows.resize (id + 1);
+      }
+    FlowState &flow = m_flows[id];
+    if (!flow.seen)
+      {
+        std::ostringstream title;
+        title << "Flow " << id << " " << t.sourceAddress << ":" << t.sourcePort
+              << " -> " << t.destinationAddress << ":" << t.destinationPort;
+        flow.dataset.SetTitle (title.str ());
+        flow.dataset.SetStyle (Gnuplot2dDataset::LINES_POINTS);
+        flow.seen = true;
+      }
+    double mbps = (rxBytes - flow.lastRxBytes) * 8.0 / m_interval.GetSeconds () / 1e6;
+    flow.lastRxBytes = rxBytes;
+    flow.dataset.Add (now, mbps);
+  }
+
+  Ptr<FlowMonitor> m_monitor;
+  Ptr<Ipv4FlowClassifier> m_classifier;
+  const FlowCounters *m_counters;     // instead of the monitor when set
+  Time m_interval;
+  std::vector<FlowState> m_flows;   // indexed by FlowId, ids start from 1 (flow + 1 for FlowCounters)
+  EventId m_event;
+};
+
+} // namespace ns3
+
+#endif /* THROUGHPUT_SAMPLER_H */
@@ -0,0 +1,370 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef UE_MEASUREMENT_RECORDER_H
+#define UE_MEASUREMENT_RECORDER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+
+#include "ns3/assert.h"
+#include "ns3/callback.h"
+#include "ns3/config.h"
+#include "ns3/log.h"
+#include "ns3/lte-ue-phy.h"
+#include "ns3/simulator.h"
+
+#include "lte-device-registry.h"
+
+namespace ns3 {
+
+/**
+ * Records the RSRP/SINR reports of every UE to ue<rnti>Traces.txt, or
+ * ue<cellId>-<rnti>Traces.txt with more than one cell, one line
+ * "time\trsrp\tsinr" per report, with constant memory. Connected through a
+ * registry, the lines carry the IMSI of the UE as a fourth column, since an
+ * RNTI is handed out again once its UE has left the cell.
+ *
+ * Each (cellId, RNTI) gets a fixed size ring buffer filled by the simulation thread; a
+ * writer thread drains the rings to their files whenever one gets half full
+ * (and at least every FlushInterval). If the writer falls behind, the
+ * simulation waits for it rather than dropping reports or growing memory.
+ *
+ *   UeMeasurementRecorder recorder;
+ *   recorder.Connect (scenario.GetDeviceRegistry ());   // or Connect () for every UE PHY
+ *   Simulator::Run ();
+ *   recorder.Stop ();      // drain and close the files
+ */
+class UeMeasurementRecorder
+{
+public:
+  /**
+   * \param prefix,suffix output file of RNTI r is prefix + r + suffix, or
+   *        prefix + cellId + "-" + r + suffix with more than one cell
+   * \param capacity reports buffered per (cellId, RNTI), rounded up to a power of two
+   */
+  UeMeasurementRecorder (const std::string &prefix = "ue", const std::string &suffix = "Traces.txt",
+                         uint32_t capacity = 4096)
+    : m_prefix (prefix),
+      m_suffix (suffix),
+      m_capacity (1),
+      m_flushInterval (200),
+      m_cellIdInFileName (false),
+      m_running (false),
+      m_stopping (false),
+      m_drainRequested (false),
+      m_error (false)
+  {
+    while (m_capacity < capacity)
+      {
+        m_capacity <<= 1;
+      }
+  }
+
+  ~UeMeasurementRecorder ()
+  {
+    Stop ();
+    for (uint32_t i = 0; i < m_rings.size (); i++)
+      {
+        delete m_rings[i];
+      }
+  }
+
+  /// Start the writer thread; Connect () does it too
+  void
+  Start (void)
+  {
+    if (m_running)
+      {
+        return;
+      }
+    m_stopping = false;
+    m_running = true;
+    m_thread = std::thread (&UeMeasurementRecorder::Run, this);
+  }
+
+  /// Write the remaining reports, stop the writer thread and close the files
+  bool
+  Stop (void)
+  {
+    if (!m_running)
+      {
+        return !m_error;
+      }
+    {
+      std::lock_guard<std::mutex> lock (m_mutex);
+      m_stopping = true;
+    }
+    m_wakeWriter.notify_one ();
+    m_thread.join ();
+    m_running = false;
+    for (uint32_t i = 0; i < m_rings.size (); i++)
+      {
+        if (m_rings[i]->file != 0 && std::fclose (m_rings[i]->file) != 0)
+          {
+            m_error = true;
+          }
+        m_rings[i]->file = 0;
+      }
+    return !m_error;
+  }
+
+  /**
+   * Put the cell ID in the file names, for Connect (path) in a scenario with
+   * more than one cell; Connect (registry) sets it from the number of eNBs.
+   * Call it before the first report.
+   */
+  void
+  SetCellIdInFileName (bool enable)
+  {
+    m_cellIdInFileName = enable;
+  }
+
+  /// Connect to the ReportCurrentCellRsrpSinr trace of the UE PHYs matching path
+  void
+  Connect (const std::string &path = "/NodeList/*/DeviceList/*/LteUePhy/ReportCurrentCellRsrpSinr")
+  {
+    Start ();
+    Config::Connect (path, MakeCallback (&UeMeasurementRecorder::ReportUeMeasurements, this));
+  }
+
+  /// Connect to the ReportCurrentCellRsrpSinr trace of the UE PHYs of the registry, without a config path
+  void
+  Connect (const LteDeviceRegistry &registry)
+  {
+    Start ();
+    if (registry.GetNEnbs () > 1)
+      {
+        m_cellIdInFileName = true;
+      }
+    for (uint32_t i = 0; i < registry.GetNUes (); i++)
+      {
+        // The IMSI is bound to the callback, no lookup from the trace
+        m_ues.push_back (UeBinding ());
+        m_ues.back ().recorder = this;
+        m_ues.back ().imsi = registry.GetUe (i).imsi;
+        registry.GetUe (i).device->GetPhy ()->TraceConnectWithoutContext (
+          "ReportCurrentCellRsrpSinr", MakeBoundCallback (&UeMeasurementRecorder::ReportCurrentCellRsrpSinr,
+                                                          &m_ues.back ()));
+      }
+  }
+
+  void
+  ReportUeMeasurements (std::string context, uint16_t cellId, uint16_t rnti, double rsrp, double sinr)
+  {
+    Record (cellId, rnti, Simulator::Now ().GetNanoSeconds () / (double) 1e9, rsrp, sinr);
+  }
+
+  /// \param imsi written as fourth column, 0 for none
+  void
+  Record (uint16_t cellId, uint16_t rnti, double time, double rsrp, double sinr, uint64_t imsi = 0)
+  {
+    NS_ASSERT_MSG (m_running, "UeMeasurementRecorder: Record () before Start (), nothing would drain the rings");
+    Ring *ring = GetRing (cellId, rnti);
+    uint64_t head = ring->head.load (std::memory_order_relaxed);
+    uint64_t used = head - ring->tail.load (std::memory_order_acquire);
+    if (used == m_capacity)
+      {
+        // The writer is behind: wake it and wait for room
+        std::unique_lock<std::mutex> lock (m_mutex);
+        while (head - ring->tail.load (std::memory_order_acquire) == m_capacity)
+          {
+            m_drainRequested = true;
+            m_wakeWriter.notify_one ();
+            m_drained.wait (lock);
+          }
+      }
+    Measurement &m = ring->buffer[head & (m_capacity - 1)];
+    m.time = time;
+    m.rsrp = rsrp;
+    m.sinr = sinr;
+    m.imsi = imsi;
+    ring->head.store (head + 1, std::memory_order_release);
+    if (used + 1 == m_capacity / 2)
+      {
+        std::lock_guard<std::mutex> lock (m_mutex);
+        m_drainRequested = true;
+        m_wakeWriter.notify_one ();
+      }
+  }
+
+private:
+  struct Measurement
+  {
+    double time;
+    double rsrp;
+    double sinr;
+    uint64_t imsi;
+  };
+
+  struct UeBinding
+  {
+    UeMeasurementRecorder *recorder;
+    uint64_t imsi;
+  };
+
+  static void
+  ReportCurrentCellRsrpSinr (UeBinding *ue, uint16_t cellId, uint16_t rnti, double rsrp, double sinr)
+  {
+    ue->recorder->Record (cellId, rnti, Simulator::Now ().GetNanoSeconds () / (double) 1e9, rsrp, sinr, ue->imsi);
+  }
+
+  // Single producer (simulation), single consumer (writer) ring
+  struct Ring
+  {
+    uint16_t cellId;
+    uint16_t rnti;
+    std::vector<Measurement> buffer;
+    std::atomic<uint64_t> head;
+    std::atomic<uint64_t> tail;
+    std::FILE *file;      // only touched by the writer thread
+  };
+
+  Ring *
+  GetRing (uint16_t cellId, uint16_t rnti)
+  {
+    if (cellId >= m_ringByCellRnti.size ())
+      {
+        m_ringByCellRnti.resize (cellId + 1);
+      }
+    std::vector<Ring *> &ringByRnti = m_ringByCellRnti[cellId];
+    if (rnti < ringByRnti.size () && ringByRnti[rnti] != 0)
+      {
+        return ringByRnti[rnti];
+      }
+    if (rnti >= ringByRnti.size ())
+      {
+        ringByRnti.resize (rnti + 1, 0);
+      }
+    Ring *ring = new Ring;
+    ring->cellId = cellId;
+    ring->rnti = rnti;
+    ring->buffer.resize (m_capacity);
+    ring->head = 0;
+    ring->tail = 0;
+    ring->file = 0;
+    ringByRnti[rnti] = ring;
+    std::lock_guard<std::mutex> lock (m_mutex);
+    m_rings.push_back (ring);
+    return ring;
+  }
+
+  void
+  Run (void)
+  {
+    std::vector<Ring *> rings;
+    std::vector<char> text;
+    bool stopping = false;
+    while (!stopping)
+      {
+        {
+          std::unique_lock<std::mutex> lock (m_mutex);
+          m_wakeWriter.wait_for (lock, std::chrono::milliseconds (m_flushInterval),
+                                 [this] { return m_drainRequested || m_stopping; });
+          m_drainRequested = false;
+          stopping = m_stopping;
+          rings = m_rings;
+        }
+        // After m_stopping is seen the simulation doesn't record anymore,
+        // so this last pass drains everything
+        for (uint32_t i = 0; i < rings.size (); i++)
+          {
+            Drain (rings[i], text);
+          }
+        std::lock_guard<std::mutex> lock (m_mutex);
+        m_drained.notify_all ();
+      }
+  }
+
+  void
+  Drain (Ring *ring, std::vector<char> &text)
+  {
+    uint64_t tail = ring->tail.load (std::memory_order_relaxed);
+    uint64_t head = ring->head.load (std::memory_order_acquire);
+    if (tail == head)
+      {
+        return;
+      }
+    if (ring->file == 0)
+      {
+        std::ostringstream filename;
+        filename << m_prefix;
+        if (m_cellIdInFileName)
+          {
+            filename << ring->cellId << "-";
+          }
+        filename << ring->rnti << m_suffix;
+        ring->file = std::fopen (filename.str ().c_str (), "w");
+        if (ring->file == 0)
+          {
+            m_error = true;
+            ring->tail.store (head, std::memory_order_release);
+            return;
+          }
+      }
+    text.resize ((head - tail) * 96);
+    size_t size = 0;
+    for (uint64_t i = tail; i < head; i++)
+      {
+        const Measurement &m = ring->buffer[i & (m_capacity - 1)];
+        // %g is the default formatting of doubles by an ostream
+        if (m.imsi != 0)
+          {
+            size += std::snprintf (&text[size], 96, "%g\t%g\t%g\t%llu\n", m.time, m.rsrp, m.sinr,
+                                   (unsigned long long) m.imsi);
+          }
+        else
+          {
+            size += std::snprintf (&text[size], 96, "%g\t%g\t%g\n", m.time, m.rsrp, m.sinr);
+          }
+      }
+    ring->tail.store (head, std::memory_order_release);
+    if (std::fwrite (&text[0], 1, size, ring->file) != size)
+      {
+        m_error = true;
+      }
+  }
+
+  std::string m_prefix;
+  std::string m_suffix;
+  uint32_t m_capacity;
+  uint32_t m_flushInterval;               // ms between two passes of the writer when idle
+  std::vector<std::vector<Ring *> > m_ringByCellRnti;   // [cellId][rnti], simulation thread only
+  std::vector<Ring *> m_rings;            // guarded by m_mutex, read by the writer
+  std::deque<UeBinding> m_ues;            // deque: stable addresses for the bound callbacks
+  bool m_cellIdInFileName;                // set before the first report, read by the writer
+  std::thread m_thread;
+  std::mutex m_mutex;
+  std::condition_variable m_wakeWriter;
+  std::condition_variable m_drained;
+  bool m_running;
+  bool m_stopping;
+  bool m_drainRequested;                  // a ring is half full, guarded by m_mutex
+  std::atomic<bool> m_error;
+};
+
+} // namespace ns3
+
+#endif /* UE_MEASUREMENT_RECORDER_H */
@@ -0,0 +1,274 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef FADING_TRACE_FILE_H
+#define FADING_TRACE_FILE_H
+
+/*
+ * Binary fading trace format (.fadb), version 1
+ *
+ * A 64 byte little-endian header followed by the fading gains in dB as
+ * float32, one row of numSamples values per RB (the same order as the rows
+ * of the text .fad files):
+ *
+ *   offset  size  field
+ *        0     8  magic "FADTRACE"
+ *        8     4  version (1)
+ *       12     4  header size in bytes (64), the data starts here
+ *       16     4  number of RBs
+ *       20     4  number of samples per RB
+ *       24     8  sampling period in seconds (double)
+ *       32     4  sample type (0 = float32 dB)
+ *       36     4  reserved
+ *       40    24  padding
+ *
+ * Keeping the header at 64 bytes leaves every row 64 byte aligned in a
+ * memory-mapped file whenever numSamples is a multiple of 16.
+ */
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ns3 {
+
+struct FadingTraceHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t headerSize;
+  uint32_t numRbs;
+  uint32_t numSamples;
+  double samplingPeriod;
+  uint32_t sampleType;
+  uint32_t reserved;
+  uint8_t padding[24];
+};
+
+static_assert (sizeof (FadingTraceHeader) == 64, "FadingTraceHeader must be 64 bytes");
+
+static const char FADING_TRACE_MAGIC[8] = { 'F', 'A', 'D', 'T', 'R', 'A', 'C', 'E' };
+static const uint32_t FADING_TRACE_VERSION = 1;
+
+/**
+ * Write a binary fading trace.
+ *
+ * \param filename output file
+ * \param numRbs number of RBs (rows)
+ * \param numSamples number of samples per RB (columns)
+ * \param samplingPeriod time between two samples, in seconds
+ * \param data numRbs x numSamples gains in dB, RB-major
+ * \return true on success
+ */
+inline bool
+WriteFadingTraceFile (const std::string &filename, uint32_t numRbs, uint32_t numSamples,
+                      double samplingPeriod, const float *data)
+{
+  FadingTraceHeader header;
+  std::memset (&header, 0, sizeof (header));
+  std::memcpy (header.magic, FADING_TRACE_MAGIC, sizeof (header.magic));
+  header.version = FADING_TRACE_VERSION;
+  header.headerSize = sizeof (header);
+  header.numRbs = numRbs;
+  header.numSamples = numSamples;
+  header.samplingPeriod = samplingPeriod;
+  header.sampleType = 0;
+
+  std::FILE *file = std::fopen (filename.c_str (), "wb");
+  if (file == 0)
+    {
+      return false;
+    }
+  size_t nValues = (size_t) numRbs * numSamples;
+  bool ok = std::fwrite (&header, sizeof (header), 1, file) == 1
+    && std::fwrite (data, sizeof (float), nValues, file) == nValues;
+  return (std::fclose (file) == 0) && ok;
+}
+
+/**
+ * Parse a text fading trace (one line of space separated dB values per RB,
+ * as written by fading_trace_generator.m) into an RB-major array.
+ *
+ * \return false if the file can't be read or the rows have different lengths
+ */
+inline bool
+ReadTextFadingTrace (const std::string &filename, std::vector<float> &data,
+                     uint32_t &numRbs, uint32_t &numSamples)
+{
+  std::ifstream inFile (filename.c_str ());
+  if (!inFile.is_open ())
+    {
+      return false;
+    }
+  data.clear ();
+  numRbs = 0;
+  numSamples = 0;
+  std::string line;
+  while (std::getline (inFile, line))
+    {
+      std::istringstream iss (line);
+      uint32_t n = 0;
+      float value;
+      while (iss >> value)
+        {
+          data.push_back (value);
+          n++;
+        }
+      if (n == 0)
+        {
+          continue;
+        }
+      if (numRbs > 0 && n != numSamples)
+        {
+          return false;
+        }
+      numSamples = n;
+      numRbs++;
+    }
+  return numRbs > 0;
+}
+
+/**
+ * Read-only memory mapping of a binary fading trace.
+ *
+ * The file is mapped shared, so all the processes of a sweep using the same
+ * trace share its pages through the page cache instead of each holding a
+ * private parsed copy.
+ */
+class FadingTraceFile
+{
+public:
+  FadingTraceFile ()
+    : m_base (0),
+      m_length (0),
+      m_header (0),
+      m_data (0)
+  {
+  }
+
+  ~FadingTraceFile ()
+  {
+    Close ();
+  }
+
+  /**
+   * Map a trace file. On failure the reason is available from GetError().
+   */
+  bool
+  Open (const std::string &filename)
+  {
+    Close ();
+    int fd = open (filename.c_str (), O_RDONLY);
+    if (fd < 0)
+      {
+        return Fail ("can't open " + filename + ": " + std::strerror (errno));
+      }
+    struct stat st;
+    if (fstat (fd, &st) != 0 || (size_t) st.st_size < sizeof (FadingTraceHeader))
+      {
+        close (fd);
+        return Fail (filename + " is too short to be a fading trace");
+      }
+    void *base = mmap (0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close (fd);
+    if (base == MAP_FAILED)
+      {
+        return Fail ("can't map " + filename + ": " + std::strerror (errno));
+      }
+    m_base = base;
+    m_length = st.st_size;
+    m_header = static_cast<const FadingTraceHeader *> (base);
+
+    if (std::memcmp (m_header->magic, FADING_TRACE_MAGIC, sizeof (FADING_TRACE_MAGIC)) != 0)
+      {
+        Close ();
+        return Fail (filename + " is not a binary fading trace");
+      }
+    if (m_header->version != FADING_TRACE_VERSION || m_header->sampleType != 0)
+      {
+        Close ();
+        return Fail (filename + " has an unsupported version or sample type");
+      }
+    size_t expected = (size_t) m_header->headerSize
+      + (size_t) m_header->numRbs * m_header->numSamples * sizeof (float);
+    if (m_header->headerSize < sizeof (FadingTraceHeader) || m_length < expected
+        || m_header->numSamples == 0 || !(m_header->samplingPeriod > 0))
+      {
+        Close ();
+        return Fail (filename + " is truncated or has an invalid header");
+      }
+    m_data = reinterpret_cast<const float *> (static_cast<const char *> (base) + m_header->headerSize);
+    madvise (base, m_length, MADV_WILLNEED);
+    return true;
+  }
+
+  void
+  Close ()
+  {
+    if (m_base != 0)
+      {
+        munmap (m_base, m_length);
+      }
+    m_base = 0;
+    m_length = 0;
+    m_header = 0;
+    m_data = 0;
+  }
+
+  bool IsOpen () const { return m_data != 0; }
+  const std::string &GetError () const { return m_error; }
+
+  uint32_t GetNumRbs () const { return m_header->numRbs; }
+  uint32_t GetNumSamples () const { return m_header->numSamples; }
+  double GetSamplingPeriod () const { return m_header->samplingPeriod; }
+
+  /// The numSamples gains (dB) of one RB
+  const float *GetRb (uint32_t rb) const { return m_data + (size_t) rb * m_header->numSamples; }
+
+  /// Gain (dB) of a RB at a sample index
+  float Get (uint32_t rb, uint32_t sample) const { return GetRb (rb)[sample]; }
+
+private:
+  FadingTraceFile (const FadingTraceFile &);
+  FadingTraceFile &operator= (const FadingTraceFile &);
+
+  bool
+  Fail (const std::string &error)
+  {
+    m_error = error;
+    return false;
+  }
+
+  void *m_base;
+  size_t m_length;
+  const FadingTraceHeader *m_header;
+  const float *m_data;
+  std::string m_error;
+};
+
+} // namespace ns3
+
+#endif /* FADING_TRACE_FILE_H */
@@ -14,17 +14,373 @@
  * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+// Fading trace tool: a native replacement of fading_trace_generator.m, and a
+// converter from text (.fad) traces to the binary (.fadb) format read by
+// MmapTraceFadingLossModel.
+//
+// Generate EPA/EVA/ETU traces for any number of speeds:
+// ./waf --run "scratch/fading-traces/fading-traces --profile=EVA,ETU --speeds=3,30,60,120" --cwd "scratch/fading-traces/"
+//
+// Convert an existing text trace:
+// ./waf --run "scratch/fading-traces/fading-traces --input=fading_trace_EVA_60kmph.fad" --cwd "scratch/fading-traces/"
+//
+// Without --profile or --input it does nothing, so the target still builds
+// and runs as a no-op like the old dummy simulator.
+//
+// Each tap of the 3GPP TS 36.104 Annex B.2 profile is an independent Rayleigh
+// process (sum-of-sinusoids with the Doppler shift of the given speed and
+// carrier), path gains are normalized to unit power, and every TTI the
+// frequency response is evaluated at numRBs frequencies spaced fs/numRBs
+// apart, as pwelch() does in the matlab script. Samples are independent of
+// each other given the realization, so the trace is split in blocks of TTIs
+// across threads and the output doesn't depend on the thread count.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <complex>
+#include <cstdio>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
 #include "ns3/core-module.h"
 
+#include "fading-trace-file.h"
+
 using namespace ns3;
 
-NS_LOG_COMPONENT_DEFINE ("DummySimulator");
+NS_LOG_COMPONENT_DEFINE ("FadingTraces");
+
+namespace {
+
+// Power delay profile of a 3GPP TS 36.104 Annex B.2 channel model
+struct TapProfile
+{
+  const char *name;
+  uint32_t numTaps;
+  double delays[9];     // excess tap delay [s]
+  double powers[9];     // relative power [dB]
+};
 
-int 
+const TapProfile g_profiles[] = {
+  { "EPA", 7,
+    { 0, 30e-9, 70e-9, 90e-9, 120e-9, 190e-9, 410e-9 },
+    { 0.0, -1.0, -2.0, -3.0, -8.0, -17.2, -20.8 } },
+  { "EVA", 9,
+    { 0, 30e-9, 150e-9, 310e-9, 370e-9, 710e-9, 1090e-9, 1730e-9, 2510e-9 },
+    { 0.0, -1.5, -1.4, -3.6, -0.6, -9.1, -7.0, -12.0, -16.9 } },
+  { "ETU", 9,
+    { 0, 50e-9, 120e-9, 200e-9, 230e-9, 500e-9, 1600e-9, 2300e-9, 5000e-9 },
+    { -1.0, -1.0, -1.0, 0.0, 0.0, 0.0, -3.0, -5.0, -7.0 } },
+};
+
+const uint32_t SINUSOIDS_PER_TAP = 16;
+
+struct GeneratorParams
+{
+  double fc;            // carrier frequency [Hz]
+  double fs;            // sampling frequency, the RB grid spans [0, fs) [Hz]
+  double tti;           // time between two samples [s]
+  uint32_t numSamples;
+  uint32_t numRbs;
+  uint32_t numThreads;
+};
+
+// One realization of the sum-of-sinusoids Rayleigh process of every tap
+// (Zheng & Xiao, "Simulation models with correct statistical properties for
+// Rayleigh fading channels", 2003)
+struct ChannelRealization
+{
+  uint32_t numTaps;
+  std::vector<double> amplitude;    // sqrt of the normalized tap power
+  std::vector<double> dopplerI;     // [tap][n] angular Doppler of the in-phase sinusoids
+  std::vector<double> dopplerQ;     // [tap][n] angular Doppler of the quadrature sinusoids
+  std::vector<double> phaseI;       // [tap][n]
+  std::vector<double> phaseQ;       // [tap][n]
+  std::vector<float> twiddleRe;     // [tap][rb] exp(-j 2 pi f_rb tau_tap)
+  std::vector<float> twiddleIm;
+};
+
+ChannelRealization
+CreateRealization (const TapProfile &profile, double fd, const GeneratorParams &params, uint64_t seed)
+{
+  std::mt19937_64 rng (seed);
+  std::uniform_real_distribution<double> uniform (-M_PI, M_PI);
+
+  ChannelRealization r;
+  r.numTaps = profile.numTaps;
+  double totalPower = 0;
+  for (uint32_t l = 0; l < profile.numTaps; l++)
+    {
+      totalPower += std::pow (10.0, profile.powers[l] / 10.0);
+    }
+  const uint32_t m = SINUSOIDS_PER_TAP;
+  for (uint32_t l = 0; l < profile.numTaps; l++)
+    {
+      r.amplitude.push_back (std::sqrt (std::pow (10.0, profile.powers[l] / 10.0) / totalPower));
+      double theta = uniform (rng);
+      for (uint32_t n = 1; n <= m; n++)
+        {
+          double alpha = (2 * M_PI * n - M_PI + theta) / (4.0 * m);
+          r.dopplerI.push_back (2 * M_PI * fd * std::cos (alpha));
+          r.dopplerQ.push_back (2 * M_PI * fd * std::sin (alpha));
+          r.phaseI.push_back (uniform (rng));
+          r.phaseQ.push_back (uniform (rng));
+        }
+      for (uint32_t k = 0; k < params.numRbs; k++)
+        {
+          double f = k * params.fs / params.numRbs;
+          double angle = -2 * M_PI * f * profile.delays[l];
+          r.twiddleRe.push_back (std::cos (angle));
+          r.twiddleIm.push_back (std::sin (angle));
+        }
+    }
+  return r;
+}
+
+// Fill samples [first, last) of the RB-major trace with the gains in dB
+void
+GenerateBlock (const ChannelRealization &r, const GeneratorParams &params,
+               uint32_t first, uint32_t last, float *trace)
+{
+  const uint32_t m = SINUSOIDS_PER_TAP;
+  const uint32_t numRbs = params.numRbs;
+  const double norm = std::sqrt (1.0 / m);    // unit power per tap: (I^2 + Q^2) averages to 1
+  std::vector<float> hRe (numRbs);
+  std::vector<float> hIm (numRbs);
+
+  for (uint32_t s = first; s < last; s++)
+    {
+      double t = s * params.tti;
+      std::fill (hRe.begin (), hRe.end (), 0.0f);
+      std::fill (hIm.begin (), hIm.end (), 0.0f);
+      for (uint32_t l = 0; l < r.numTaps; l++)
+        {
+          double gI = 0;
+          double gQ = 0;
+          for (uint32_t n = 0; n < m; n++)
+            {
+              gI += std::cos (r.dopplerI[l * m + n] * t + r.phaseI[l * m + n]);
+              gQ += std::cos (r.dopplerQ[l * m + n] * t + r.phaseQ[l * m + n]);
+            }
+          const float gRe = r.amplitude[l] * norm * gI;
+          const float gIm = r.amplitude[l] * norm * gQ;
+          // H(f_k) += g_l * exp(-j 2 pi f_k tau_l), a straight loop over the
+          // contiguous RB arrays the compiler can vectorize
+          const float *wRe = &r.twiddleRe[l * numRbs];
+          const float *wIm = &r.twiddleIm[l * numRbs];
+          for (uint32_t k = 0; k < numRbs; k++)
+            {
+              hRe[k] += gRe * wRe[k] - gIm * wIm[k];
+              hIm[k] += gRe * wIm[k] + gIm * wRe[k];
+            }
+        }
+      for (uint32_t k = 0; k < numRbs; k++)
+        {
+          float power = hRe[k] * hRe[k] + hIm[k] * hIm[k];
+          trace[(size_t) k * params.numSamples + s] = 10.0f * std::log10 (std::max (power, 1e-30f));
+        }
+    }
+}
+
+std::vector<float>
+GenerateTrace (const TapProfile &profile, double speedKmph, const GeneratorParams &params, uint64_t seed)
+{
+  double lambda = 3e8 / params.fc;
+  double fd = speedKmph / 3.6 / lambda;
+  ChannelRealization r = CreateRealization (profile, fd, params, seed);
+
+  std::vector<float> trace ((size_t) params.numRbs * params.numSamples);
+  uint32_t numThreads = std::max (1u, std::min (params.numThreads, params.numSamples));
+  uint32_t blockSize = (params.numSamples + numThreads - 1) / numThreads;
+  std::vector<std::thread> threads;
+  for (uint32_t i = 0; i < numThreads; i++)
+    {
+      uint32_t first = i * blockSize;
+      uint32_t last = std::min (params.numSamples, first + blockSize);
+      if (first >= last)
+        {
+          break;
+        }
+      threads.push_back (std::thread (GenerateBlock, std::cref (r), std::cref (params), first, last, &trace[0]));
+    }
+  for (uint32_t i = 0; i < threads.size (); i++)
+    {
+      threads[i].join ();
+    }
+  return trace;
+}
+
+bool
+WriteTextFadingTrace (const std::string &filename, uint32_t numRbs, uint32_t numSamples, const float *data)
+{
+  std::FILE *file = std::fopen (filename.c_str (), "w");
+  if (file == 0)
+    {
+      return false;
+    }
+  for (uint32_t k = 0; k < numRbs; k++)
+    {
+      for (uint32_t s = 0; s < numSamples; s++)
+        {
+          std::fprintf (file, "%g ", data[(size_t) k * numSamples + s]);
+        }
+      std::fputc ('\n', file);
+    }
+  return std::fclose (file) == 0;
+}
+
+std::vector<std::string>
+SplitString (const std::string &str, char delimiter)
+{
+  std::vector<std::string> tokens;
+  std::stringstream ss (str);
+  std::string token;
+  while (std::getline (ss, token, delimiter))
+    {
+      if (!token.empty ())
+        {
+          tokens.push_back (token);
+        }
+    }
+  return tokens;
+}
+
+int
+ConvertTrace (const std::string &input, std::string output, double samplingPeriod)
+{
+  if (output.empty ())
+    {
+      std::string::size_type dot = input.rfind ('.');
+      output = (dot == std::string::npos ? input : input.substr (0, dot)) + ".fadb";
+    }
+
+  std::vector<float> data;
+  uint32_t numRbs = 0;
+  uint32_t numSamples = 0;
+  if (!ReadTextFadingTrace (input, data, numRbs, numSamples))
+    {
+      NS_FATAL_ERROR ("Can't parse fading trace " << input);
+    }
+  if (!WriteFadingTraceFile (output, numRbs, numSamples, samplingPeriod, &data[0]))
+    {
+      NS_FATAL_ERROR ("Can't write " << output);
+    }
+  NS_LOG_UNCOND (input << " -> " << output << ": " << numRbs << " RBs x "
+                 << numSamples << " samples, " << samplingPeriod << " s/sample");
+  return 0;
+}
+
+} // anonymous namespace
+
+int
 main (int argc, char *argv[])
 {
-  NS_LOG_UNCOND ("Dummy Simulator");
+  std::string input = "";
+  std::string output = "";
+  double samplingPeriod = 0.001;    // one sample per TTI, as in fading_trace_generator.m
+
+  std::string profiles = "";
+  std::string speeds = "3";
+  double fc = 1930e6;               // UL EARFCN=18100, as in fading_trace_generator.m
+  double fs = 20e6;
+  double duration = 10.0;
+  uint32_t numRbs = 100;
+  uint32_t seed = 1;
+  uint32_t threads = std::thread::hardware_concurrency ();
+  std::string format = "fad,fadb";
+
+  CommandLine cmd;
+  cmd.AddValue ("input", "Text fading trace (.fad) to convert", input);
+  cmd.AddValue ("output", "Binary trace to write [Default=input with .fadb extension]", output);
+  cmd.AddValue ("samplingPeriod", "Time between two samples of the trace, in seconds", samplingPeriod);
+  cmd.AddValue ("profile", "Comma separated channel models to generate (EPA, EVA, ETU)", profiles);
+  cmd.AddValue ("speeds", "Comma separated UE speeds in km/h, one trace per speed and profile", speeds);
+  cmd.AddValue ("fc", "Carrier frequency in Hz [Default=1930e6]", fc);
+  cmd.AddValue ("fs", "Sampling frequency in Hz, the RBs span [0, fs) [Default=20e6]", fs);
+  cmd.AddValue ("duration", "Trace duration in seconds [Default=10]", duration);
+  cmd.AddValue ("rbs", "Number of RBs [Default=100]", numRbs);
+  cmd.AddValue ("seed", "Seed of the channel realizations", seed);
+  cmd.AddValue ("threads", "Number of generator threads [Default=number of cores]", threads);
+  cmd.AddValue ("format", "Comma separated output formats: fad (text) and/or fadb (binary)", format);
+  cmd.Parse (argc, argv);
+
+  if (!input.empty ())
+    {
+      return ConvertTrace (input, output, samplingPeriod);
+    }
+  if (profiles.empty ())
+    {
+      NS_LOG_UNCOND ("Nothing to do, use --profile=<EPA,EVA,ETU> to generate traces"
+                     " or --input=<trace.fad> to convert a text trace");
+      return 0;
+    }
+
+  bool writeText = false;
+  bool writeBinary = false;
+  std::vector<std::string> formats = SplitString (format, ',');
+  for (uint32_t i = 0; i < formats.size (); i++)
+    {
+      if (formats[i] == "fad")
+        {
+          writeText = true;
+        }
+      else if (formats[i] == "fadb")
+        {
+          writeBinary = true;
+        }
+      else
+        {
+          NS_FATAL_ERROR ("Unknown trace format " << formats[i] << ", use fad or fadb");
+        }
+    }
+
+  GeneratorParams params;
+  params.fc = fc;
+  params.fs = fs;
+  params.tti = samplingPeriod;
+  params.numSamples = (uint32_t) std::floor (duration / samplingPeriod + 0.5);
+  params.numRbs = numRbs;
+  params.numThreads = threads > 0 ? threads : 1;
+
+  std::vector<std::string> profileNames = SplitString (profiles, ',');
+  std::vector<std::string> speedValues = SplitString (speeds, ',');
+  for (uint32_t p = 0; p < profileNames.size (); p++)
+    {
+      const TapProfile *profile = 0;
+      for (uint32_t i = 0; i < sizeof (g_profiles) / sizeof (g_profiles[0]); i++)
+        {
+          if (profileNames[p] == g_profiles[i].name)
+            {
+              profile = &g_profiles[i];
+            }
+        }
+      if (profile == 0)
+        {
+          NS_FATAL_ERROR ("Unknown channel model " << profileNames[p] << ", use EPA, EVA or ETU");
+        }
+      for (uint32_t v = 0; v < speedValues.size (); v++)
+        {
+          double speed = std::atof (speedValues[v].c_str ());
+          std::string tag = std::string ("fading_trace_") + profile->name + "_" + speedValues[v] + "kmph";
+          // Different, but reproducible, realizations for each trace
+          uint64_t traceSeed = seed * 1000003ULL + p * 1009ULL + v;
+          std::vector<float> trace = GenerateTrace (*profile, speed, params, traceSeed);
 
-  Simulator::Run ();
-  Simulator::Destroy ();
+          if (writeText && !WriteTextFadingTrace (tag + ".fad", numRbs, params.numSamples, &trace[0]))
+            {
+              NS_FATAL_ERROR ("Can't write " << tag << ".fad");
+            }
+          if (writeBinary && !WriteFadingTraceFile (tag + ".fadb", numRbs, params.numSamples, samplingPeriod, &trace[0]))
+            {
+              NS_FATAL_ERROR ("Can't write " << tag << ".fadb");
+            }
+          NS_LOG_UNCOND (tag << ": " << numRbs << " RBs x " << params.numSamples << " samples at "
+                         << speed << " km/h, fc " << fc / 1e6 << " MHz");
+        }
+    }
+  return 0;
 }
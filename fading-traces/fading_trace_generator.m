@@ -129,3 +129,14 @@ end
 
 fclose(file);
 
+
+%BINARY FILE GENERATION (.fadb version 1, layout in fading-trace-file.h)
+% 64 byte header followed by the same RB x sample matrix as float32, RB-major
+file = fopen(strcat('fading_trace_',tag,'.fadb'),'w','ieee-le');
+fwrite(file, 'FADTRACE', 'char*1');
+fwrite(file, [1 64 numRBs len], 'uint32');  % version, header size, RBs, samples
+fwrite(file, TTI, 'double');                % sampling period [s]
+fwrite(file, [0 0], 'uint32');              % sample type (float32 dB), reserved
+fwrite(file, zeros(1,24), 'uint8');         % padding
+fwrite(file, (10.*log10(ppssdd(1:numRBs,1:len)))', 'float32');
+fclose(file);
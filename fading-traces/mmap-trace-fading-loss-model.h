@@ -0,0 +1,349 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef MMAP_TRACE_FADING_LOSS_MODEL_H
+#define MMAP_TRACE_FADING_LOSS_MODEL_H
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ns3/boolean.h"
+#include "ns3/double.h"
+#include "ns3/lte-helper.h"
+#include "ns3/mobility-model.h"
+#include "ns3/nstime.h"
+#include "ns3/object.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/simulator.h"
+#include "ns3/spectrum-propagation-loss-model.h"
+#include "ns3/spectrum-value.h"
+#include "ns3/string.h"
+#include "ns3/uinteger.h"
+
+#include "../common/rb-kernels.h"
+#include "fading-trace-file.h"
+
+namespace ns3 {
+
+/**
+ * Replacement of TraceFadingLossModel reading binary (.fadb) traces.
+ *
+ * The trace is memory-mapped instead of parsed into vectors, so startup costs
+ * nothing and concurrent runs share a single copy of the trace in memory.
+ * The number of RBs, the number of samples and the sampling period come from
+ * the file header; the windowing (a random start offset per tx/rx pair,
+ * redrawn every WindowSize) is the same as TraceFadingLossModel's.
+ *
+ * The gains of a sample are converted to linear units the first time the
+ * sample is used and kept (LinearGainCache), sample-major, so applying the
+ * fading to a PSD is one SIMD multiply over contiguous RBs (RbMultiply)
+ * instead of a pow per RB. The cache costs up to the size of the trace in
+ * private memory, only for the samples actually used.
+ *
+ * It is not a TraceFadingLossModel, so LteHelper::AssignStreams, which only
+ * looks for one, leaves it alone: a scenario fixing its streams calls
+ * AssignStreamsToInstances itself once the devices (and with them the fading
+ * model) are installed.
+ *
+ *   SetTraceFadingModel (lteHelper, "fading_trace_EVA_60kmph.fadb");   // .fad for TraceFadingLossModel
+ *   ...
+ *   stream += lteHelper->AssignStreams (devs, stream);
+ *   stream += MmapTraceFadingLossModel::AssignStreamsToInstances (stream);
+ */
+class MmapTraceFadingLossModel : public SpectrumPropagationLossModel
+{
+public:
+  static TypeId
+  GetTypeId (void)
+  {
+    static TypeId tid = TypeId ("ns3::MmapTraceFadingLossModel")
+      .SetParent<SpectrumPropagationLossModel> ()
+      .AddConstructor<MmapTraceFadingLossModel> ()
+      .AddAttribute ("TraceFilename",
+                     "Name of the binary (.fadb) fading trace file to map.",
+                     StringValue (""),
+                     MakeStringAccessor (&MmapTraceFadingLossModel::m_traceFile),
+                     MakeStringChecker ())
+      .AddAttribute ("WindowSize",
+                     "Size of the window used for each tx/rx pair before drawing a new offset.",
+                     TimeValue (Seconds (0.5)),
+                     MakeTimeAccessor (&MmapTraceFadingLossModel::m_windowSize),
+                     MakeTimeChecker ())
+      .AddAttribute ("LinearGainCache",
+                     "Keep the linear gains of the samples used, instead of converting the dB values on every call.",
+                     BooleanValue (true),
+                     MakeBooleanAccessor (&MmapTraceFadingLossModel::m_linearGainCache),
+                     MakeBooleanChecker ())
+    ;
+    return tid;
+  }
+
+  MmapTraceFadingLossModel ()
+    : m_linearGainCache (true),
+      m_lastWindowUpdate (Seconds (0)),
+      m_streamsAssigned (false),
+      m_streamSetSize (400000),
+      m_currentStream (0),
+      m_lastStream (0)
+  {
+    GetInstances ().push_back (this);
+  }
+
+  virtual ~MmapTraceFadingLossModel ()
+  {
+    std::vector<MmapTraceFadingLossModel *> &instances = GetInstances ();
+    instances.erase (std::remove (instances.begin (), instances.end (), this), instances.end ());
+  }
+
+  /// Whether filename names a binary trace (.fadb), for this model, or a text one (.fad)
+  static bool
+  IsBinaryTrace (const std::string &filename)
+  {
+    return filename.size () > 5 && filename.compare (filename.size () - 5, 5, ".fadb") == 0;
+  }
+
+  /**
+   * Assign a fixed random variable stream number to the random variables
+   * used by this model, as TraceFadingLossModel::AssignStreams does: a set
+   * of streams, one per tx/rx pair, starting at stream.
+   *
+   * \return the number of streams used
+   */
+  int64_t
+  AssignStreams (int64_t stream)
+  {
+    m_streamsAssigned = true;
+    m_currentStream = stream;
+    m_lastStream = stream + m_streamSetSize - 1;
+    std::map<ChannelRealizationId_t, Realization>::iterator it;
+    for (it = m_realizations.begin (); it != m_realizations.end (); ++it)
+      {
+        it->second.startVariable->SetStream (m_currentStream);
+        m_currentStream += 1;
+      }
+    return m_streamSetSize;
+  }
+
+  /**
+   * AssignStreams on every model alive (the one LteHelper installs), since
+   * LteHelper::AssignStreams doesn't reach them.
+   *
+   * \return the number of streams used
+   */
+  static int64_t
+  AssignStreamsToInstances (int64_t stream)
+  {
+    const std::vector<MmapTraceFadingLossModel *> &instances = GetInstances ();
+    int64_t currentStream = stream;
+    for (uint32_t i = 0; i < instances.size (); i++)
+      {
+        currentStream += instances[i]->AssignStreams (currentStream);
+      }
+    return currentStream - stream;
+  }
+
+  /// The mapped trace, loading it if needed
+  const FadingTraceFile &
+  GetTrace () const
+  {
+    LoadTrace ();
+    return m_trace;
+  }
+
+protected:
+  virtual void
+  DoInitialize (void)
+  {
+    LoadTrace ();
+    SpectrumPropagationLossModel::DoInitialize ();
+  }
+
+  virtual void
+  DoDispose (void)
+  {
+    m_realizations.clear ();
+    m_linearGains.reset ();
+    m_converted.clear ();
+    m_trace.Close ();
+    SpectrumPropagationLossModel::DoDispose ();
+  }
+
+private:
+  typedef std::pair<Ptr<const MobilityModel>, Ptr<const MobilityModel> > ChannelRealizationId_t;
+
+  struct Realization
+  {
+    Ptr<UniformRandomVariable> startVariable;
+    uint32_t offset;    // start sample of the current window
+  };
+
+  void
+  LoadTrace () const
+  {
+    if (m_trace.IsOpen ())
+      {
+        return;
+      }
+    if (!m_trace.Open (m_traceFile))
+      {
+        NS_FATAL_ERROR ("MmapTraceFadingLossModel: " << m_trace.GetError ());
+      }
+    if (m_windowSize.GetSeconds () >= m_trace.GetNumSamples () * m_trace.GetSamplingPeriod ())
+      {
+        NS_FATAL_ERROR ("MmapTraceFadingLossModel: WindowSize must be shorter than the trace (" << m_traceFile << ")");
+      }
+  }
+
+  // Linear gains of all the RBs at a sample, converted on first use
+  const float *
+  GetLinearGains (uint32_t sample) const
+  {
+    uint32_t numRbs = m_trace.GetNumRbs ();
+    if (m_converted.empty ())
+      {
+        // not value-initialized: only the pages of the samples used get memory
+        m_linearGains.reset (new float[(size_t) m_trace.GetNumSamples () * numRbs]);
+        m_converted.assign (m_trace.GetNumSamples (), false);
+      }
+    float *gains = m_linearGains.get () + (size_t) sample * numRbs;
+    if (!m_converted[sample])
+      {
+        RbDbToLinear (gains, m_trace.GetRb (0) + sample, m_trace.GetNumSamples (), numRbs);
+        m_converted[sample] = true;
+      }
+    return gains;
+  }
+
+  virtual Ptr<SpectrumValue>
+  DoCalcRxPowerSpectralDensity (Ptr<const SpectrumValue> txPsd,
+                                Ptr<const MobilityModel> a,
+                                Ptr<const MobilityModel> b) const
+  {
+    LoadTrace ();
+    double samplingPeriod = m_trace.GetSamplingPeriod ();
+    uint32_t numSamples = m_trace.GetNumSamples ();
+    uint32_t numRbs = m_trace.GetNumRbs ();
+
+    ChannelRealizationId_t mobilityPair = std::make_pair (a, b);
+    std::map<ChannelRealizationId_t, Realization>::iterator itRealization = m_realizations.find (mobilityPair);
+    if (itRealization != m_realizations.end ())
+      {
+        if (Simulator::Now () >= m_lastWindowUpdate + m_windowSize)
+          {
+            // update all the offsets
+            std::map<ChannelRealizationId_t, Realization>::iterator it;
+            for (it = m_realizations.begin (); it != m_realizations.end (); ++it)
+              {
+                it->second.offset = (uint32_t) it->second.startVariable->GetValue ();
+              }
+            m_lastWindowUpdate = Simulator::Now ();
+          }
+      }
+    else
+      {
+        Realization realization;
+        realization.startVariable = CreateObject<UniformRandomVariable> ();
+        realization.startVariable->SetAttribute ("Min", DoubleValue (1.0));
+        realization.startVariable->SetAttribute ("Max", DoubleValue (numSamples - m_windowSize.GetSeconds () / samplingPeriod));
+        if (m_streamsAssigned)
+          {
+            NS_ASSERT_MSG (m_currentStream <= m_lastStream, "not enough streams, consider increasing the stream set size");
+            realization.startVariable->SetStream (m_currentStream);
+            m_currentStream += 1;
+          }
+        realization.offset = (uint32_t) realization.startVariable->GetValue ();
+        itRealization = m_realizations.insert (std::make_pair (mobilityPair, realization)).first;
+      }
+
+    Ptr<SpectrumValue> rxPsd = Copy<SpectrumValue> (txPsd);
+    uint64_t elapsed = (uint64_t) ((Simulator::Now () - m_lastWindowUpdate).GetSeconds () / samplingPeriod);
+    uint32_t index = (itRealization->second.offset + elapsed) % numSamples;
+
+    uint32_t numBands = rxPsd->ValuesEnd () - rxPsd->ValuesBegin ();
+    NS_ASSERT_MSG (numBands <= numRbs, "the fading trace has fewer RBs than the spectrum model");
+    if (m_linearGainCache)
+      {
+        if (numBands > 0)     // ValuesBegin () of an empty model can't be dereferenced
+          {
+            RbMultiply (&*rxPsd->ValuesBegin (), GetLinearGains (index), numBands);
+          }
+        return rxPsd;
+      }
+    uint32_t subChannel = 0;
+    for (Values::iterator vit = rxPsd->ValuesBegin (); vit != rxPsd->ValuesEnd (); ++vit, ++subChannel)
+      {
+        if (*vit != 0.)
+          {
+            *vit *= std::pow (10.0, m_trace.Get (subChannel, index) / 10.0);
+          }
+      }
+    return rxPsd;
+  }
+
+  static std::vector<MmapTraceFadingLossModel *> &
+  GetInstances (void)
+  {
+    static std::vector<MmapTraceFadingLossModel *> instances;
+    return instances;
+  }
+
+  std::string m_traceFile;
+  Time m_windowSize;
+  bool m_linearGainCache;
+  mutable FadingTraceFile m_trace;
+  mutable std::unique_ptr<float[]> m_linearGains;   // sample-major, numRbs per sample
+  mutable std::vector<bool> m_converted;
+
+  mutable std::map<ChannelRealizationId_t, Realization> m_realizations;
+  mutable Time m_lastWindowUpdate;
+  bool m_streamsAssigned;
+  uint64_t m_streamSetSize;
+  mutable uint64_t m_currentStream;
+  uint64_t m_lastStream;
+};
+
+NS_OBJECT_ENSURE_REGISTERED (MmapTraceFadingLossModel);
+
+/**
+ * Use the fading trace 'path' for lteHelper: a binary trace (.fadb) through
+ * MmapTraceFadingLossModel, memory-mapped and shared by concurrent runs,
+ * which reads its dimensions from the file; a text trace through
+ * TraceFadingLossModel, with the dimensions of the traces shipped with ns-3
+ * (10 s, 10000 samples, 100 RBs). Both redraw their offsets every 0.5 s.
+ */
+inline void
+SetTraceFadingModel (Ptr<LteHelper> lteHelper, const std::string &path)
+{
+  bool binaryTrace = MmapTraceFadingLossModel::IsBinaryTrace (path);
+  lteHelper->SetFadingModel (binaryTrace ? "ns3::MmapTraceFadingLossModel" : "ns3::TraceFadingLossModel");
+  lteHelper->SetFadingModelAttribute ("TraceFilename", StringValue (path));
+  lteHelper->SetFadingModelAttribute ("WindowSize", TimeValue (Seconds (0.5)));
+  if (!binaryTrace)
+    {
+      lteHelper->SetFadingModelAttribute ("TraceLength", TimeValue (Seconds (10.0)));
+      lteHelper->SetFadingModelAttribute ("SamplesNum", UintegerValue (10000));
+      lteHelper->SetFadingModelAttribute ("RbNum", UintegerValue (100));
+    }
+}
+
+} // namespace ns3
+
+#endif /* MMAP_TRACE_FADING_LOSS_MODEL_H */